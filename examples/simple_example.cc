@@ -4,6 +4,7 @@
 
 #include "simple_example.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <fstream>
@@ -94,9 +95,18 @@ Mesh ReadMesh(const std::string& filename) {
             Vec3{nml.values[0], nml.values[1], nml.values[2]};
       });
 
-  // Open the OBJ file and populate the mesh while parsing it.
+  // Open the OBJ file. A quick first pass counts the elements in the file
+  // so that storage can be allocated once, then a second pass populates
+  // the mesh while parsing it.
   auto ifs = std::ifstream(filename);
   assert(ifs);
+  const auto count = thinks::CountObj(ifs);
+  mesh.vertices.reserve(std::max({count.position_count, count.tex_coord_count,
+                                  count.normal_count}));
+  mesh.indices.reserve(count.face_index_count);
+  ifs.clear();
+  ifs.seekg(0);
+
   const auto result =
       thinks::ReadObj(ifs, add_position, add_face, add_tex_coord, add_normal);
   ifs.close();
@@ -4,15 +4,75 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <exception>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#endif
+
+// ObjReader is available when compiling with coroutine support (C++20).
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#include <iterator>
+#include <optional>
+#include <variant>
+#define THINKS_OBJ_IO_COROUTINES
+#endif
+#endif
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define THINKS_OBJ_IO_EXCEPTIONS
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define THINKS_OBJ_IO_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define THINKS_OBJ_IO_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace thinks {
 
 template <typename ArithT, std::size_t N>
@@ -175,6 +235,95 @@ struct ObjPolygonFace {
   std::vector<IndexT> values;
 };
 
+namespace obj_io_internal {
+
+// Sequence that stores up to N values inline and only allocates
+// when more values are added.
+template <typename T, std::size_t N>
+class SmallVector {
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  SmallVector() noexcept : size_(0) {}
+
+  SmallVector(std::initializer_list<T> values) : size_(0) {
+    for (const auto& value : values) {
+      push_back(value);
+    }
+  }
+
+  void push_back(const T& value) {
+    if (heap_.empty()) {
+      if (size_ < N) {
+        inline_[size_++] = value;
+        return;
+      }
+      heap_.reserve(2 * N);
+      heap_.assign(inline_.begin(), inline_.end());
+    }
+    heap_.push_back(value);
+    ++size_;
+  }
+
+  void clear() noexcept {
+    heap_.clear();
+    size_ = 0;
+  }
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  T* data() noexcept { return heap_.empty() ? inline_.data() : heap_.data(); }
+  const T* data() const noexcept {
+    return heap_.empty() ? inline_.data() : heap_.data();
+  }
+
+  T& operator[](const std::size_t i) noexcept { return data()[i]; }
+  const T& operator[](const std::size_t i) const noexcept {
+    return data()[i];
+  }
+
+  iterator begin() noexcept { return data(); }
+  iterator end() noexcept { return data() + size_; }
+  const_iterator begin() const noexcept { return data(); }
+  const_iterator end() const noexcept { return data() + size_; }
+
+ private:
+  std::array<T, N> inline_;
+  std::vector<T> heap_;
+  std::size_t size_;
+};
+
+}  // namespace obj_io_internal
+
+// Same as ObjPolygonFace, but faces with at most N indices are stored
+// without heap allocations.
+template <typename IndexT, std::size_t N = 8>
+struct ObjSmallPolygonFace {
+  static_assert(obj_io_internal::IsIndex<IndexT>::value,
+                "face values must be of index type");
+  static_assert(N >= 3, "inline index count must be at least 3");
+
+  ObjSmallPolygonFace() noexcept = default;
+
+  ObjSmallPolygonFace(std::initializer_list<IndexT> indices)
+      : values(indices) {}
+
+  obj_io_internal::SmallVector<IndexT, N> values;
+};
+
+// A line with an unrecognized prefix, e.g. "usemtl material". The rest of
+// the line has no leading or trailing whitespace. The characters are only
+// valid during the add function call.
+struct ObjUnknownLine {
+  const char* prefix;
+  std::size_t prefix_size;
+  const char* rest;
+  std::size_t rest_size;
+};
+
 template <typename T>
 struct ObjMapResult {
   T value;
@@ -191,6 +340,26 @@ ObjMapResult<T> ObjEnd() noexcept {
   return {T{}, true};
 }
 
+// Mapper that passes elements to the writer in batches. Calling
+// func(elements, max_count) must store up to max_count elements in the
+// array elements and return the number of elements stored, zero when there
+// are no more elements.
+template <typename T, typename Func, std::size_t N>
+struct ObjBatchMapFunc {
+  static_assert(N > 0, "batch size must be positive");
+
+  using MappedType = T;
+  static constexpr std::size_t kBatchSize = N;
+
+  Func func;
+};
+
+template <typename T, std::size_t N = 256, typename Func>
+ObjBatchMapFunc<T, typename std::decay<Func>::type, N> MakeObjBatchMapFunc(
+    Func&& func) {
+  return {std::forward<Func>(func)};
+}
+
 template <typename ParseT, typename Func>
 struct ObjAddFunc {
   using ParseType = ParseT;
@@ -206,6 +375,407 @@ ObjAddFunc<ParseT, typename std::decay<Func>::type> MakeObjAddFunc(
 
 namespace obj_io_internal {
 
+struct IgnoreUnknownLine {
+  void operator()(const ObjUnknownLine&) const noexcept {}
+};
+
+}  // namespace obj_io_internal
+
+// Reads leniently, i.e. skips lines with unrecognized prefixes instead of
+// failing, when passed as the unknown line add function.
+inline ObjAddFunc<ObjUnknownLine, obj_io_internal::IgnoreUnknownLine>
+MakeObjSkipUnknownLinesFunc() noexcept {
+  return {};
+}
+
+namespace obj_io_internal {
+
+// Collects parsed elements and passes them on in contiguous batches.
+template <typename ParseT, typename Func>
+class BatchBuffer {
+ public:
+  BatchBuffer(Func func, const std::size_t batch_size)
+      : func_(std::move(func)),
+        batch_size_(std::max(batch_size, std::size_t{1})) {
+    elements_.reserve(batch_size_);
+  }
+
+  void operator()(const ParseT& element) {
+    elements_.push_back(element);
+    if (elements_.size() == batch_size_) {
+      Flush();
+    }
+  }
+
+  // Elements are moved out before func is called, so that a batch is
+  // passed on at most once, also if func throws. The storage is reused
+  // when func returns.
+  void Flush() {
+    if (!elements_.empty()) {
+      auto batch = std::move(elements_);
+      elements_.clear();
+      func_(static_cast<const ParseT*>(batch.data()), batch.size());
+      batch.clear();
+      elements_ = std::move(batch);
+    }
+  }
+
+ private:
+  Func func_;
+  std::size_t batch_size_;
+  std::vector<ParseT> elements_;
+};
+
+}  // namespace obj_io_internal
+
+// Same as ObjAddFunc, but func is called as func(const ParseT* elements,
+// std::size_t count) with at most batch size elements at a time. Remaining
+// elements are passed on before the read function returns or throws.
+template <typename ParseT, typename Func>
+struct ObjAddBatchFunc {
+  using ParseType = ParseT;
+
+  obj_io_internal::BatchBuffer<ParseT, Func> func;
+};
+
+template <typename ParseT, typename Func>
+ObjAddBatchFunc<ParseT, typename std::decay<Func>::type> MakeObjAddBatchFunc(
+    Func&& func, const std::size_t batch_size = 1024) {
+  return {{std::forward<Func>(func), batch_size}};
+}
+
+namespace obj_io_internal {
+
+template <typename T>
+struct TriangleIndex;  // Not implemented!
+
+template <typename IndexT>
+struct TriangleIndex<ObjTriangleFace<IndexT>> {
+  using Type = IndexT;
+};
+
+template <typename IntT>
+IntT PositionIndexValue(const ObjIndex<IntT>& index) noexcept {
+  return index.value;
+}
+
+template <typename IntT>
+IntT PositionIndexValue(const ObjIndexGroup<IntT>& index) noexcept {
+  return index.position_index.value;
+}
+
+// Splits polygons into triangles that share the first index. Only correct
+// for convex polygons.
+struct FanTriangulator {
+  template <typename IndexT, typename EmitFunc>
+  void operator()(const IndexT* const indices, const std::size_t count,
+                  EmitFunc&& emit) const {
+    for (auto i = std::size_t{2}; i < count; ++i) {
+      emit(indices[0], indices[i - 1], indices[i]);
+    }
+  }
+};
+
+// Splits polygons into triangles by repeatedly clipping off ears, which
+// also handles concave polygons. Polygons are projected onto the coordinate
+// plane most aligned with their (Newell) normal. Falls back to a fan for
+// the remaining indices if no ear can be found, e.g. for self-intersecting
+// polygons.
+template <typename PositionFunc>
+class EarClipTriangulator {
+ public:
+  explicit EarClipTriangulator(PositionFunc position_func)
+      : position_func_(std::move(position_func)) {}
+
+  template <typename IndexT, typename EmitFunc>
+  void operator()(const IndexT* const indices, const std::size_t count,
+                  EmitFunc&& emit) {
+    if (count == 3) {
+      emit(indices[0], indices[1], indices[2]);
+      return;
+    }
+
+    // Scratch buffers are kept between calls to avoid allocations.
+    points_.clear();
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      const auto position = position_func_(PositionIndexValue(indices[i]));
+      points_.push_back({{static_cast<double>(position.values[0]),
+                          static_cast<double>(position.values[1]),
+                          static_cast<double>(position.values[2])}});
+    }
+    Project();
+
+    remaining_.clear();
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      remaining_.push_back(i);
+    }
+    while (remaining_.size() > 3) {
+      const auto ear = FindEar();
+      if (ear == remaining_.size()) {
+        break;
+      }
+      const auto m = remaining_.size();
+      emit(indices[remaining_[(ear + m - 1) % m]], indices[remaining_[ear]],
+           indices[remaining_[(ear + 1) % m]]);
+      remaining_.erase(remaining_.begin() +
+                       static_cast<std::ptrdiff_t>(ear));
+    }
+    for (auto i = std::size_t{2}; i < remaining_.size(); ++i) {
+      emit(indices[remaining_[0]], indices[remaining_[i - 1]],
+           indices[remaining_[i]]);
+    }
+  }
+
+ private:
+  // Replaces the points with counter-clockwise 2D coordinates, stored in
+  // the first two elements.
+  void Project() {
+    auto normal = std::array<double, 3>{{0.0, 0.0, 0.0}};
+    for (auto i = std::size_t{0}; i < points_.size(); ++i) {
+      const auto& a = points_[i];
+      const auto& b = points_[(i + 1) % points_.size()];
+      normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+      normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+      normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+    const auto abs = [](const double x) { return x < 0.0 ? -x : x; };
+    auto axis = std::size_t{0};
+    for (auto i = std::size_t{1}; i < 3; ++i) {
+      if (abs(normal[i]) > abs(normal[axis])) {
+        axis = i;
+      }
+    }
+    const auto u = (axis + 1) % 3;
+    const auto v = (axis + 2) % 3;
+    const auto sign = normal[axis] < 0.0 ? -1.0 : 1.0;
+    for (auto& point : points_) {
+      point = {{point[u], sign * point[v], 0.0}};
+    }
+  }
+
+  // Twice the signed area of the triangle (a, b, c).
+  double Area(const std::size_t a, const std::size_t b,
+              const std::size_t c) const noexcept {
+    const auto& pa = points_[a];
+    const auto& pb = points_[b];
+    const auto& pc = points_[c];
+    return (pb[0] - pa[0]) * (pc[1] - pa[1]) -
+           (pb[1] - pa[1]) * (pc[0] - pa[0]);
+  }
+
+  // Returns the position in remaining_ of a convex vertex whose triangle
+  // contains no other vertex, or remaining_.size() if there is none.
+  std::size_t FindEar() const noexcept {
+    const auto m = remaining_.size();
+    for (auto k = std::size_t{0}; k < m; ++k) {
+      const auto prev = remaining_[(k + m - 1) % m];
+      const auto curr = remaining_[k];
+      const auto next = remaining_[(k + 1) % m];
+      if (Area(prev, curr, next) <= 0.0) {
+        continue;  // Reflex or degenerate.
+      }
+      auto is_ear = true;
+      for (const auto i : remaining_) {
+        if (i != prev && i != curr && i != next &&
+            Area(prev, curr, i) >= 0.0 && Area(curr, next, i) >= 0.0 &&
+            Area(next, prev, i) >= 0.0) {
+          is_ear = false;
+          break;
+        }
+      }
+      if (is_ear) {
+        return k;
+      }
+    }
+    return m;
+  }
+
+  PositionFunc position_func_;
+  std::vector<std::array<double, 3>> points_;
+  std::vector<std::size_t> remaining_;
+};
+
+}  // namespace obj_io_internal
+
+// Face add function that is passed triangles, faces with more than three
+// indices are split up while parsing. FaceT must be an ObjTriangleFace type.
+// The face count of the read result is the number of triangles.
+template <typename FaceT, typename Func, typename TriangulatorT>
+struct ObjAddTriangulateFunc {
+  using ParseType = FaceT;
+  using IndexType = typename obj_io_internal::TriangleIndex<FaceT>::Type;
+
+  Func func;
+  TriangulatorT triangulator;
+};
+
+// Fan triangulation, assumes that faces are convex.
+template <typename FaceT, typename Func>
+ObjAddTriangulateFunc<FaceT, typename std::decay<Func>::type,
+                      obj_io_internal::FanTriangulator>
+MakeObjAddTriangulateFunc(Func&& func) {
+  return {std::forward<Func>(func), {}};
+}
+
+// Ear clipping triangulation, also handles concave faces. Calling
+// position_func(index) must return the ObjPosition type for a (zero-based)
+// position index. Positions are looked up while faces are read, so they
+// must have been added already.
+template <typename FaceT, typename Func, typename PositionFunc>
+ObjAddTriangulateFunc<
+    FaceT, typename std::decay<Func>::type,
+    obj_io_internal::EarClipTriangulator<
+        typename std::decay<PositionFunc>::type>>
+MakeObjAddEarClipFunc(Func&& func, PositionFunc&& position_func) {
+  using TriangulatorType = obj_io_internal::EarClipTriangulator<
+      typename std::decay<PositionFunc>::type>;
+  return {std::forward<Func>(func),
+          TriangulatorType(std::forward<PositionFunc>(position_func))};
+}
+
+struct ObjReadFlags {
+  enum : std::uint32_t {
+    kNone = 0,
+
+    // Skips range checks, i.e. texture coordinate values outside [0, 1]
+    // and polygon faces with fewer than three indices are passed on.
+    kNoValidation = 1u << 0,
+
+    // Skips value count checks, assuming well-formed input. Surplus values
+    // are ignored and missing values are value-initialized.
+    kTrustedInput = 1u << 1
+  };
+};
+
+// Compile-time read options, e.g.
+//   ReadObj<ObjReadOptions<ObjReadFlags::kNoValidation |
+//                          ObjReadFlags::kTrustedInput>>(...)
+// for files produced by a trusted pipeline. Skipped checks are not part of
+// the generated parse code at all. The default options check everything.
+template <std::uint32_t Flags = ObjReadFlags::kNone>
+struct ObjReadOptions {
+  static constexpr bool kValidate = (Flags & ObjReadFlags::kNoValidation) == 0;
+  static constexpr bool kCheckCounts =
+      (Flags & ObjReadFlags::kTrustedInput) == 0;
+};
+
+enum class ObjReadErrorCode : std::uint8_t {
+  kOk = 0,
+  kUnrecognizedLinePrefix,
+  kParseFailed,
+  kTooManyValues,
+  kIndexNotPositive,
+  kIndexGroupTokenCount,
+  kEmptyPositionIndex,
+  kEmptyNormalIndex,
+  kPositionValueCount,
+  kFaceIndexCount,
+  kPolygonIndexCount,
+  kTexCoordValueCount,
+  kTexCoordRange,
+  kNormalValueCount
+};
+
+namespace obj_io_internal {
+namespace read {
+
+struct StatusAccess;
+
+}  // namespace read
+}  // namespace obj_io_internal
+
+// Outcome of an exception-free read. Parsing only records the error code,
+// location and a few values, the message is formatted when requested and
+// is the same as the message thrown by ReadObj.
+class ObjReadStatus {
+ public:
+  ObjReadErrorCode code() const noexcept { return code_; }
+  bool ok() const noexcept { return code_ == ObjReadErrorCode::kOk; }
+
+  // One-based number of the line that failed to parse, zero if ok.
+  std::uint64_t line() const noexcept { return line_; }
+
+  // Offset in bytes from the start of the input to the beginning of the
+  // line that failed to parse.
+  std::uint64_t byte_offset() const noexcept { return byte_offset_; }
+
+  std::string message() const {
+    // Tokens longer than the inline buffer are shown truncated.
+    auto token = std::string(token_.data(), token_size_);
+    if (token_truncated_) {
+      token += "...";
+    }
+
+    auto oss = std::ostringstream{};
+    switch (code_) {
+      case ObjReadErrorCode::kOk:
+        break;
+      case ObjReadErrorCode::kUnrecognizedLinePrefix:
+        oss << "unrecognized line prefix '" << token << "'";
+        break;
+      case ObjReadErrorCode::kParseFailed:
+        oss << "failed parsing '" << token << "'";
+        break;
+      case ObjReadErrorCode::kTooManyValues:
+        oss << "expected to parse at most " << expected_count_ << " values";
+        break;
+      case ObjReadErrorCode::kIndexNotPositive:
+        oss << "parsed index must be greater than zero";
+        break;
+      case ObjReadErrorCode::kIndexGroupTokenCount:
+        oss << "index group can have at most 3 tokens ('" << token << "')";
+        break;
+      case ObjReadErrorCode::kEmptyPositionIndex:
+        oss << "empty position index ('" << token << "')";
+        break;
+      case ObjReadErrorCode::kEmptyNormalIndex:
+        oss << "empty normal index ('" << token << "')";
+        break;
+      case ObjReadErrorCode::kPositionValueCount:
+        oss << "positions must have 3 or 4 values (found " << found_count_
+            << ")";
+        break;
+      case ObjReadErrorCode::kFaceIndexCount:
+        oss << "expected " << expected_count_ << " face indices (found "
+            << found_count_ << ")";
+        break;
+      case ObjReadErrorCode::kPolygonIndexCount:
+        oss << "faces must have at least 3 indices (found " << found_count_
+            << ")";
+        break;
+      case ObjReadErrorCode::kTexCoordValueCount:
+        oss << "texture coordinates must have 2 or 3 values (found "
+            << found_count_ << ")";
+        break;
+      case ObjReadErrorCode::kTexCoordRange:
+        oss << "texture coordinate values must be in range [0, 1] (found "
+            << value_ << ")";
+        break;
+      case ObjReadErrorCode::kNormalValueCount:
+        oss << "normals must have 3 values (found " << found_count_ << ")";
+        break;
+    }
+    return oss.str();
+  }
+
+ private:
+  friend struct obj_io_internal::read::StatusAccess;
+
+  static constexpr std::size_t kMaxTokenSize = 64;
+
+  ObjReadErrorCode code_ = ObjReadErrorCode::kOk;
+  bool token_truncated_ = false;
+  std::uint8_t token_size_ = 0;
+  std::array<char, kMaxTokenSize> token_ = {};
+  std::size_t expected_count_ = 0;
+  std::size_t found_count_ = 0;
+  double value_ = 0;
+  std::uint64_t line_ = 0;
+  std::uint64_t byte_offset_ = 0;
+};
+
+namespace obj_io_internal {
+
 template <typename T>
 struct IsPositionImpl : std::false_type {};
 
@@ -245,6 +815,9 @@ struct IsFaceImpl<ObjQuadFace<IndexT>> : std::true_type {};
 template <typename IndexT>
 struct IsFaceImpl<ObjPolygonFace<IndexT>> : std::true_type {};
 
+template <typename IndexT, std::size_t N>
+struct IsFaceImpl<ObjSmallPolygonFace<IndexT, N>> : std::true_type {};
+
 template <typename T>
 using IsFace = IsFaceImpl<typename std::decay<T>::type>;
 
@@ -270,6 +843,11 @@ struct FaceTraitsImpl<ObjPolygonFace<IndexT>> {
   using FaceCategory = DynamicFaceTag;
 };
 
+template <typename IndexT, std::size_t N>
+struct FaceTraitsImpl<ObjSmallPolygonFace<IndexT, N>> {
+  using FaceCategory = DynamicFaceTag;
+};
+
 template <typename T>
 using FaceTraits = FaceTraitsImpl<typename std::decay<T>::type>;
 
@@ -278,15 +856,56 @@ struct FuncTag {};
 struct NoOpFuncTag {};
 
 template <typename T>
-struct FuncTraits {
+struct FuncTraitsImpl {
   using FuncCategory = FuncTag;
 };
 
 template <>
-struct FuncTraits<std::nullptr_t> {
+struct FuncTraitsImpl<std::nullptr_t> {
   using FuncCategory = NoOpFuncTag;
 };
 
+template <typename T>
+using FuncTraits = FuncTraitsImpl<typename std::decay<T>::type>;
+
+// Tag dispatch for write mappers that return one element per call or fill
+// a batch of elements.
+struct ElementMapperTag {};
+struct BatchMapperTag {};
+
+template <typename T>
+struct MapperTraitsImpl {
+  using MapperCategory = ElementMapperTag;
+  using MappedType =
+      typename std::decay<decltype(std::declval<T&>()().value)>::type;
+};
+
+template <typename T, typename Func, std::size_t N>
+struct MapperTraitsImpl<ObjBatchMapFunc<T, Func, N>> {
+  using MapperCategory = BatchMapperTag;
+  using MappedType = T;
+};
+
+template <typename T>
+using MapperTraits = MapperTraitsImpl<typename std::decay<T>::type>;
+
+// Tag dispatch for face add functions that triangulate.
+struct ParseFaceTag {};
+struct TriangulateFaceTag {};
+
+template <typename T>
+struct FaceFuncTraitsImpl {
+  using FaceFuncCategory = ParseFaceTag;
+};
+
+template <typename FaceT, typename Func, typename TriangulatorT>
+struct FaceFuncTraitsImpl<ObjAddTriangulateFunc<FaceT, Func, TriangulatorT>> {
+  using FaceFuncCategory = TriangulateFaceTag;
+};
+
+template <typename T>
+using FaceFuncTraits = FaceFuncTraitsImpl<typename std::decay<T>::type>;
+
 template <typename FloatT, std::size_t N>
 void ValidateObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord) {
   using ValueType = typename decltype(tex_coord.values)::value_type;
@@ -325,224 +944,735 @@ constexpr inline const char* IndexGroupSeparator() { return "/"; }
 
 namespace read {
 
-inline std::vector<std::string> Tokenize(const std::string& str,
-                                         const char* const delimiters) {
-  auto tokens = std::vector<std::string>{};
-  auto prev = std::size_t{0};
-  auto pos = std::size_t{0};
-  while ((pos = str.find_first_of(delimiters, prev)) != std::string::npos) {
-    if (pos == prev) {
-      tokens.push_back(std::string{});
+// Records errors in an ObjReadStatus without allocating. The setters
+// return false so that parse functions can return their result directly.
+struct StatusAccess {
+  static bool SetError(ObjReadStatus* const status,
+                       const ObjReadErrorCode code) noexcept {
+    status->code_ = code;
+    return false;
+  }
+
+  static bool SetError(ObjReadStatus* const status,
+                       const ObjReadErrorCode code, const char* const first,
+                       const char* const last) noexcept {
+    status->token_size_ = 0;
+    for (auto pos = first; pos != last; ++pos) {
+      AppendToken(status, *pos);
     }
-    if (pos > prev) {
-      tokens.push_back(str.substr(prev, pos - prev));
+    return SetError(status, code);
+  }
+
+  static bool SetCountError(ObjReadStatus* const status,
+                            const ObjReadErrorCode code,
+                            const std::size_t expected_count,
+                            const std::size_t found_count) noexcept {
+    status->expected_count_ = expected_count;
+    status->found_count_ = found_count;
+    return SetError(status, code);
+  }
+
+  static bool SetValueError(ObjReadStatus* const status,
+                            const ObjReadErrorCode code,
+                            const double value) noexcept {
+    status->value_ = value;
+    return SetError(status, code);
+  }
+
+  static void AppendToken(ObjReadStatus* const status, const char c) noexcept {
+    if (status->token_size_ < ObjReadStatus::kMaxTokenSize) {
+      status->token_[status->token_size_++] = c;
+    } else {
+      status->token_truncated_ = true;
     }
-    prev = pos + 1;  // Skip delimiter.
   }
 
-  // Check for characters after last delimiter.
-  if (prev == str.length()) {
-    tokens.push_back(std::string{});
+  static void SetLocation(ObjReadStatus* const status, const std::uint64_t line,
+                          const std::uint64_t byte_offset) noexcept {
+    status->line_ = line;
+    status->byte_offset_ = byte_offset;
   }
-  if (prev < str.length()) {
-    tokens.push_back(str.substr(prev, std::string::npos));
+
+  // For statuses from parsing part of the input.
+  static void AddLocation(ObjReadStatus* const status,
+                          const std::uint64_t line_count,
+                          const std::uint64_t byte_count) noexcept {
+    status->line_ += line_count;
+    status->byte_offset_ += byte_count;
   }
+};
 
-  return tokens;
+#if defined(THINKS_OBJ_IO_EXCEPTIONS)
+inline void ThrowIfError(const ObjReadStatus& status) {
+  if (!status.ok()) {
+    throw std::runtime_error(status.message());
+  }
 }
+#endif  // defined(THINKS_OBJ_IO_EXCEPTIONS)
 
-inline std::vector<std::string> TokenizeIndexGroup(
-    const std::string& index_group_str) {
-  return Tokenize(index_group_str, IndexGroupSeparator());
-}
+template <typename FloatT, std::size_t N>
+bool ValidateObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord,
+                         ObjReadStatus* const status) {
+  using ValueType = typename decltype(tex_coord.values)::value_type;
 
-template <typename T>
-bool ParseValue(std::istream* const is, T* const value) {
-  if (*is >> *value || !is->eof()) {
-    if (is->fail()) {
-      is->clear();  // Clear status bits.
-      auto dummy = std::string{};
-      *is >> dummy;
-      auto oss = std::ostringstream{};
-      oss << "failed parsing '" << dummy << "'";
-      throw std::runtime_error(oss.str());
+  for (const auto v : tex_coord.values) {
+    if (!(ValueType{0} <= v && v <= ValueType{1})) {
+      return StatusAccess::SetValueError(
+          status, ObjReadErrorCode::kTexCoordRange, static_cast<double>(v));
     }
-    return true;
   }
-  return false;
+  return true;
 }
 
-template <typename IntT>
-std::istream& operator>>(std::istream& is, ObjIndex<IntT>& index) {
-  if (ParseValue(&is, &index.value)) {
-    // Check for underflow.
-    if (!(index.value > 0)) {
-      throw std::runtime_error("parsed index must be greater than zero");
-    }
-
-    // Convert to zero-based index.
-    --index.value;
+template <typename FaceT>
+bool ValidateFace(const FaceT& face, DynamicFaceTag,
+                  ObjReadStatus* const status) {
+  if (!(face.values.size() >= 3)) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kPolygonIndexCount, 3, face.values.size());
   }
+  return true;
+}
 
-  return is;
+template <typename FaceT>
+bool ValidateFace(const FaceT&, StaticFaceTag, ObjReadStatus* const) {
+  return true;
 }
 
-template <typename IntT>
-std::istream& operator>>(std::istream& is, ObjIndexGroup<IntT>& index_group) {
-  // Read index group as the string leading up to the
-  // following whitespace/newline.
-  auto index_group_str = std::string{};
-  if (!ParseValue(&is, &index_group_str)) {
-    return is;
+// Stream buffer that reads directly from a range of characters owned by
+// someone else, so that lines can be parsed without being copied.
+class CharRangeBuf : public std::streambuf {
+ public:
+  void Reset(const char* const first, const char* const last) {
+    // The get area is never written to.
+    const auto begin = const_cast<char*>(first);
+    setg(begin, begin, const_cast<char*>(last));
   }
 
-  const auto tokens = TokenizeIndexGroup(index_group_str);
-  if (tokens.empty()) {
-    throw std::runtime_error("empty index group tokens");
-  }
+  const char* position() const noexcept { return gptr(); }
+  const char* end() const noexcept { return egptr(); }
 
-  if (tokens.size() > 3) {
-    auto oss = std::stringstream{};
-    oss << "index group can have at most 3 tokens ('" << index_group_str
-        << "')";
-    throw std::runtime_error(oss.str());
+  void Seek(const char* const pos) {
+    setg(eback(), const_cast<char*>(pos), egptr());
   }
+};
 
-  // ObjPosition index.
-  if (tokens[0].empty()) {
-    auto oss = std::stringstream{};
-    oss << "empty position index ('" << index_group_str << "')";
-    throw std::runtime_error(oss.str());
-  }
-  auto iss_pos = std::istringstream(tokens[0]);
-  iss_pos >> index_group.position_index;
+// Input stream that is re-targeted at each new line instead of
+// constructing a new stream per line. Parsers that work on raw characters
+// may read and advance the current position directly.
+class LineStream : public std::istream {
+ public:
+  LineStream() : std::istream(nullptr) { rdbuf(&buf_); }
 
-  // Texture coordinate index, may be empty.
-  if (tokens.size() > 1 && !tokens[1].empty()) {
-    auto iss_tex = std::istringstream(tokens[1]);
-    iss_tex >> index_group.tex_coord_index.first;
-    index_group.tex_coord_index.second = true;
-  }
+  LineStream(const LineStream&) = delete;
+  LineStream& operator=(const LineStream&) = delete;
 
-  // ObjNormal index.
-  if (tokens.size() > 2) {
-    if (tokens[2].empty()) {
-      auto oss = std::stringstream{};
-      oss << "empty normal index ('" << index_group_str << "')";
-      throw std::runtime_error(oss.str());
-    }
-    auto iss_nml = std::istringstream(tokens[2]);
-    iss_nml >> index_group.normal_index.first;
-    index_group.normal_index.second = true;
+  void Reset(const char* const first, const char* const last) {
+    buf_.Reset(first, last);
+    clear();  // Clear status bits from previous line.
   }
 
-  return is;
+  const char* position() const noexcept { return buf_.position(); }
+  const char* end() const noexcept { return buf_.end(); }
+
+  void Seek(const char* const pos) { buf_.Seek(pos); }
+
+ private:
+  CharRangeBuf buf_;
+};
+
+// Same characters as std::isspace in the "C" locale.
+constexpr inline bool IsSpace(const char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+         c == '\r';
 }
 
-template <typename T, std::size_t N>
-std::uint32_t ParseValues(std::istringstream* const iss,
-                          std::array<T, N>* const values) {
-  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
-  using ValueType = typename ContainerType::value_type;
+constexpr inline bool IsDigit(const char c) { return '0' <= c && c <= '9'; }
+
+// Returns the end of the longest prefix of [first, last) that stream
+// extraction of a floating point value would consume, i.e.
+// [sign] digits [. digits] [(e|E) [sign] digits]. Returns first if the
+// prefix is not a complete number (e.g. "-", "." or "1e").
+inline const char* ScanDecimal(const char* const first,
+                               const char* const last) {
+  auto pos = first;
+  if (pos != last && (*pos == '+' || *pos == '-')) {
+    ++pos;
+  }
 
-  constexpr auto kValueCount = std::tuple_size<ContainerType>::value;
-  static_assert(kValueCount > 0, "empty array");
+  auto mantissa_digits = false;
+  while (pos != last && IsDigit(*pos)) {
+    ++pos;
+    mantissa_digits = true;
+  }
+  if (pos != last && *pos == '.') {
+    ++pos;
+    while (pos != last && IsDigit(*pos)) {
+      ++pos;
+      mantissa_digits = true;
+    }
+  }
+  if (!mantissa_digits) {
+    return first;
+  }
 
-  auto parse_count = std::uint32_t{0};
-  auto value = ValueType{};
-  while (ParseValue(iss, &value)) {
-    if (parse_count >= kValueCount) {
-      auto oss = std::ostringstream{};
-      oss << "expected to parse at most " << kValueCount << " values";
-      throw std::runtime_error(oss.str());
+  if (pos != last && (*pos == 'e' || *pos == 'E')) {
+    ++pos;
+    if (pos != last && (*pos == '+' || *pos == '-')) {
+      ++pos;
+    }
+    auto exponent_digits = false;
+    while (pos != last && IsDigit(*pos)) {
+      ++pos;
+      exponent_digits = true;
+    }
+    if (!exponent_digits) {
+      return first;
     }
-    (*values)[parse_count++] = value;
   }
 
-  return parse_count;
+  return pos;
 }
 
-template <typename T>
-std::uint32_t ParseValues(std::istringstream* const iss,
-                          std::vector<T>* const values) {
-  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
-  using ValueType = typename ContainerType::value_type;
-
-  auto value = ValueType{};
-  while (ParseValue(iss, &value)) {
-    values->push_back(value);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+
+// Converts [first, last), which must have been validated by ScanDecimal,
+// to the nearest floating point value. Returns false if the conversion
+// could not be done exactly here, in which case callers fall back to
+// stream extraction (e.g. for values out of range).
+template <typename FloatT>
+bool ParseDecimal(const char* first, const char* const last,
+                  FloatT* const value) {
+  // Leading plus signs are accepted by streams, but not by from_chars.
+  if (*first == '+') {
+    ++first;
   }
-
-  return static_cast<std::uint32_t>(values->size());
+  const auto result = std::from_chars(first, last, *value);
+  return result.ec == std::errc{} && result.ptr == last;
 }
 
-template <typename AddPositionFuncT>
-void ParsePosition(std::istringstream* const iss, AddPositionFuncT&& add_position,
-                   std::uint32_t* const count) {
-  using ParseType = typename std::decay<AddPositionFuncT>::type::ParseType;
-  static_assert(IsPosition<ParseType>::value,
-                "parse type must be a ObjPosition type");
+#else
 
-  auto position = ParseType{};
-  const auto parse_count = ParseValues(iss, &position.values);
+// Exact powers of ten for Clinger's fast path.
+template <typename FloatT>
+struct ExactPow10;
 
-  if (parse_count < 3) {
-    auto oss = std::ostringstream{};
-    oss << "positions must have 3 or 4 values (found " << parse_count << ")";
-    throw std::runtime_error(oss.str());
+template <>
+struct ExactPow10<float> {
+  static constexpr int kMaxExponent = 10;
+  static constexpr std::uint64_t kMaxMantissa = std::uint64_t{1} << 24;
+
+  static float Get(const int e) {
+    static constexpr float kPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                       1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    return kPow10[e];
   }
+};
 
-  // Fourth position value (if any) defaults to 1.
-  using ArrayType = decltype(position.values);
-  if (std::tuple_size<ArrayType>::value == 4 && parse_count == 3) {
-    position.values[3] = typename ArrayType::value_type{1};
+template <>
+struct ExactPow10<double> {
+  static constexpr int kMaxExponent = 22;
+  static constexpr std::uint64_t kMaxMantissa = std::uint64_t{1} << 53;
+
+  static double Get(const int e) {
+    static constexpr double kPow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return kPow10[e];
+  }
+};
+
+// When both the decimal mantissa and the power of ten are exactly
+// representable a single multiplication or division is correctly rounded.
+template <typename FloatT>
+bool ClingerFastPath(const std::uint64_t mantissa, const int exponent,
+                     FloatT* const value) {
+  using Pow10 = ExactPow10<FloatT>;
+  if (mantissa > Pow10::kMaxMantissa || exponent < -Pow10::kMaxExponent ||
+      exponent > Pow10::kMaxExponent) {
+    return false;
+  }
+  *value = static_cast<FloatT>(mantissa);
+  if (exponent < 0) {
+    *value /= Pow10::Get(-exponent);
+  } else {
+    *value *= Pow10::Get(exponent);
+  }
+  return true;
+}
+
+inline bool DecimalToFloat(const std::uint64_t mantissa, const int exponent,
+                           float* const value) {
+  if (ClingerFastPath(mantissa, exponent, value)) {
+    return true;
+  }
+
+  // Round to double first. This only double-rounds incorrectly if the
+  // double lands exactly on the midpoint between two floats, which is
+  // checked for explicitly. The double result is always well within the
+  // range of normal floats here.
+  auto d = double{0};
+  if (!ClingerFastPath(mantissa, exponent, &d)) {
+    return false;
+  }
+  auto bits = std::uint64_t{0};
+  std::memcpy(&bits, &d, sizeof(d));
+  constexpr auto kDroppedBits = 52 - 23;
+  constexpr auto kDroppedMask = (std::uint64_t{1} << kDroppedBits) - 1;
+  constexpr auto kMidpoint = std::uint64_t{1} << (kDroppedBits - 1);
+  if ((bits & kDroppedMask) == kMidpoint) {
+    return false;
+  }
+  *value = static_cast<float>(d);
+  return true;
+}
+
+inline bool DecimalToFloat(const std::uint64_t mantissa, const int exponent,
+                           double* const value) {
+  return ClingerFastPath(mantissa, exponent, value);
+}
+
+// Converts [first, last), which must have been validated by ScanDecimal,
+// to the nearest floating point value. Returns false if the conversion
+// could not be done exactly here, in which case callers fall back to
+// stream extraction. This happens only for long mantissas and large
+// exponents, which are rare in OBJ files.
+template <typename FloatT>
+bool ParseDecimal(const char* first, const char* const last,
+                  FloatT* const value) {
+  const auto negative = *first == '-';
+  if (*first == '+' || *first == '-') {
+    ++first;
+  }
+
+  // Accumulate at most 19 significant digits, which always fit in 64 bits.
+  constexpr auto kMaxDigits = 19;
+  auto mantissa = std::uint64_t{0};
+  auto digit_count = 0;
+  auto exponent = 0;
+  auto pos = first;
+  for (; pos != last && IsDigit(*pos); ++pos) {
+    if (mantissa == 0 && *pos == '0') {
+      continue;  // Leading zeros are not significant.
+    }
+    if (++digit_count > kMaxDigits) {
+      return false;
+    }
+    mantissa = 10 * mantissa + static_cast<std::uint64_t>(*pos - '0');
+  }
+  if (pos != last && *pos == '.') {
+    for (++pos; pos != last && IsDigit(*pos); ++pos) {
+      --exponent;
+      if (mantissa == 0 && *pos == '0') {
+        continue;
+      }
+      if (++digit_count > kMaxDigits) {
+        return false;
+      }
+      mantissa = 10 * mantissa + static_cast<std::uint64_t>(*pos - '0');
+    }
+  }
+  if (pos != last) {
+    // Exponent, digits are guaranteed by ScanDecimal.
+    ++pos;
+    const auto negative_exponent = *pos == '-';
+    if (*pos == '+' || *pos == '-') {
+      ++pos;
+    }
+    auto e = 0;
+    for (; pos != last; ++pos) {
+      if (e > 9999) {
+        return false;  // Way out of range, leave it to the fallback.
+      }
+      e = 10 * e + (*pos - '0');
+    }
+    exponent += negative_exponent ? -e : e;
+  }
+
+  if (mantissa == 0) {
+    *value = FloatT{0};
+  } else if (!DecimalToFloat(mantissa, exponent, value)) {
+    return false;
+  }
+  if (negative) {
+    *value = -*value;
+  }
+  return true;
+}
+
+#endif  // defined(__cpp_lib_to_chars)
+
+template <typename T>
+bool ParseValue(std::istream* const is, T* const value,
+                ObjReadStatus* const status) {
+  if (*is >> *value || !is->eof()) {
+    if (is->fail()) {
+      is->clear();  // Clear status bits.
+
+      // Record the rest of the token.
+      *is >> std::ws;
+      const auto buf = is->rdbuf();
+      for (auto c = buf->sgetc();
+           c != std::char_traits<char>::eof() &&
+           !IsSpace(std::char_traits<char>::to_char_type(c));
+           c = buf->snextc()) {
+        StatusAccess::AppendToken(status,
+                                  std::char_traits<char>::to_char_type(c));
+      }
+      return StatusAccess::SetError(status, ObjReadErrorCode::kParseFailed);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Locale-independent fast path for floating point values. Values that
+// cannot be handled exactly here are extracted by the stream as before,
+// so results are identical either way.
+template <typename FloatT>
+typename std::enable_if<std::is_floating_point<FloatT>::value, bool>::type
+ParseValue(LineStream* const is, FloatT* const value,
+           ObjReadStatus* const status) {
+  auto pos = is->position();
+  const auto end = is->end();
+  while (pos != end && IsSpace(*pos)) {
+    ++pos;
+  }
+
+  const auto decimal_end = ScanDecimal(pos, end);
+  if (decimal_end != pos && ParseDecimal(pos, decimal_end, value)) {
+    is->Seek(decimal_end);
+    return true;
+  }
+  return ParseValue(static_cast<std::istream*>(is), value, status);
+}
+
+// Parses a one-based index at the start of the token [first, last) and
+// stores it as a zero-based index. Characters after the leading digits
+// are left for the caller. Returns the end of the parsed characters, or
+// null on failure.
+template <typename IntT>
+const char* ParseIndex(const char* const first, const char* const last,
+                       ObjIndex<IntT>* const index,
+                       ObjReadStatus* const status) {
+  auto pos = first;
+  const auto negative = pos != last && *pos == '-';
+  if (pos != last && (*pos == '+' || *pos == '-')) {
+    ++pos;
+  }
+
+  constexpr auto kMaxValue =
+      static_cast<std::uint64_t>(std::numeric_limits<IntT>::max());
+  const auto digits_begin = pos;
+  auto value = std::uint64_t{0};
+  auto overflow = false;
+  for (; pos != last && IsDigit(*pos); ++pos) {
+    const auto digit = static_cast<std::uint64_t>(*pos - '0');
+    if (value > (kMaxValue - digit) / 10) {
+      overflow = true;
+    } else {
+      value = 10 * value + digit;
+    }
+  }
+
+  if (pos == digits_begin || overflow) {
+    StatusAccess::SetError(status, ObjReadErrorCode::kParseFailed, first,
+                           last);
+    return nullptr;
+  }
+
+  // Check for underflow.
+  if (negative || !(value > 0)) {
+    StatusAccess::SetError(status, ObjReadErrorCode::kIndexNotPositive);
+    return nullptr;
+  }
+
+  // Convert to zero-based index.
+  index->value = static_cast<IntT>(value - 1);
+  return pos;
+}
+
+// Returns the end of the whitespace-delimited token starting at first.
+inline const char* FindTokenEnd(const char* first, const char* const last) {
+  while (first != last && !IsSpace(*first)) {
+    ++first;
+  }
+  return first;
+}
+
+// Skips whitespace and returns the beginning of the next token.
+inline const char* FindTokenBegin(const char* first, const char* const last) {
+  while (first != last && IsSpace(*first)) {
+    ++first;
+  }
+  return first;
+}
+
+template <typename IntT>
+bool ParseValue(LineStream* const is, ObjIndex<IntT>* const index,
+                ObjReadStatus* const status) {
+  const auto token_begin = FindTokenBegin(is->position(), is->end());
+  if (token_begin == is->end()) {
+    is->Seek(token_begin);
+    return false;
+  }
+
+  const auto token_end = FindTokenEnd(token_begin, is->end());
+  const auto index_end = ParseIndex(token_begin, token_end, index, status);
+  if (index_end == nullptr) {
+    return false;
+  }
+  is->Seek(index_end);
+  return true;
+}
+
+// Parses an index group, e.g. "1", "1/2", "1//3" or "1/2/3", straight from
+// the line characters.
+template <typename IntT>
+bool ParseValue(LineStream* const is, ObjIndexGroup<IntT>* const index_group,
+                ObjReadStatus* const status) {
+  const auto token_begin = FindTokenBegin(is->position(), is->end());
+  if (token_begin == is->end()) {
+    is->Seek(token_begin);
+    return false;
+  }
+  const auto token_end = FindTokenEnd(token_begin, is->end());
+  is->Seek(token_end);
+
+  // Locate (at most) two separators.
+  const auto separator = *IndexGroupSeparator();
+  const auto find_separator = [token_end, separator](const char* pos) {
+    while (pos != token_end && *pos != separator) {
+      ++pos;
+    }
+    return pos;
+  };
+  const auto first_separator = find_separator(token_begin);
+  const auto second_separator = first_separator == token_end
+                                    ? token_end
+                                    : find_separator(first_separator + 1);
+  if (second_separator != token_end &&
+      find_separator(second_separator + 1) != token_end) {
+    return StatusAccess::SetError(
+        status, ObjReadErrorCode::kIndexGroupTokenCount, token_begin,
+        token_end);
+  }
+
+  // ObjPosition index.
+  if (first_separator == token_begin) {
+    return StatusAccess::SetError(status, ObjReadErrorCode::kEmptyPositionIndex,
+                                  token_begin, token_end);
+  }
+  if (ParseIndex(token_begin, first_separator, &index_group->position_index,
+                 status) == nullptr) {
+    return false;
+  }
+
+  // Texture coordinate index, may be empty.
+  if (first_separator != token_end &&
+      first_separator + 1 != second_separator) {
+    if (ParseIndex(first_separator + 1, second_separator,
+                   &index_group->tex_coord_index.first, status) == nullptr) {
+      return false;
+    }
+    index_group->tex_coord_index.second = true;
+  }
+
+  // ObjNormal index.
+  if (second_separator != token_end) {
+    if (second_separator + 1 == token_end) {
+      return StatusAccess::SetError(status, ObjReadErrorCode::kEmptyNormalIndex,
+                                    token_begin, token_end);
+    }
+    if (ParseIndex(second_separator + 1, token_end,
+                   &index_group->normal_index.first, status) == nullptr) {
+      return false;
+    }
+    index_group->normal_index.second = true;
+  }
+
+  return true;
+}
+
+// Callers must check the status, parsing stops at the first error.
+template <typename OptionsT, typename T, std::size_t N>
+std::uint32_t ParseValues(LineStream* const is,
+                          std::array<T, N>* const values,
+                          ObjReadStatus* const status) {
+  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
+  using ValueType = typename ContainerType::value_type;
+
+  constexpr auto kValueCount = std::tuple_size<ContainerType>::value;
+  static_assert(kValueCount > 0, "empty array");
+
+  auto parse_count = std::uint32_t{0};
+  if (!OptionsT::kCheckCounts) {
+    while (parse_count < kValueCount &&
+           ParseValue(is, &(*values)[parse_count], status)) {
+      ++parse_count;
+    }
+    return parse_count;
+  }
+
+  auto value = ValueType{};
+  while (ParseValue(is, &value, status)) {
+    if (parse_count >= kValueCount) {
+      StatusAccess::SetCountError(status, ObjReadErrorCode::kTooManyValues,
+                                  kValueCount, parse_count + 1);
+      break;
+    }
+    (*values)[parse_count++] = value;
+  }
+
+  return parse_count;
+}
+
+template <typename OptionsT, typename T, std::size_t N>
+std::uint32_t ParseValues(LineStream* const is,
+                          SmallVector<T, N>* const values,
+                          ObjReadStatus* const status) {
+  auto value = T{};
+  while (ParseValue(is, &value, status)) {
+    values->push_back(value);
+  }
+
+  return static_cast<std::uint32_t>(values->size());
+}
+
+template <typename OptionsT, typename T>
+std::uint32_t ParseValues(LineStream* const is,
+                          std::vector<T>* const values,
+                          ObjReadStatus* const status) {
+  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
+  using ValueType = typename ContainerType::value_type;
+
+  auto value = ValueType{};
+  while (ParseValue(is, &value, status)) {
+    values->push_back(value);
+  }
+
+  return static_cast<std::uint32_t>(values->size());
+}
+
+template <typename OptionsT, typename AddPositionFuncT>
+bool ParsePosition(LineStream* const is, AddPositionFuncT&& add_position,
+                   std::uint64_t* const count, ObjReadStatus* const status) {
+  using ParseType = typename std::decay<AddPositionFuncT>::type::ParseType;
+  static_assert(IsPosition<ParseType>::value,
+                "parse type must be a ObjPosition type");
+
+  auto position = ParseType{};
+  const auto parse_count = ParseValues<OptionsT>(is, &position.values, status);
+  if (!status->ok()) {
+    return false;
+  }
+
+  if (OptionsT::kCheckCounts && parse_count < 3) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kPositionValueCount, 3, parse_count);
+  }
+
+  // Fourth position value (if any) defaults to 1.
+  using ArrayType = decltype(position.values);
+  if (std::tuple_size<ArrayType>::value == 4 && parse_count == 3) {
+    position.values[3] = typename ArrayType::value_type{1};
   }
 
   add_position.func(position);
   ++(*count);
+  return true;
 }
 
-template <typename AddFaceFuncT>
-void ParseFace(std::istringstream* const iss, 
+template <typename OptionsT, typename AddFaceFuncT>
+bool ParseFace(LineStream* const is, 
                AddFaceFuncT&& add_face,
-               std::uint32_t* const count) {
+               std::uint64_t* const count,
+               ObjReadStatus* const status,
+               ParseFaceTag) {
   using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
   static_assert(IsFace<ParseType>::value, "parse type must be a Face type");
 
   auto face = ParseType{};
-  const auto parse_count = ParseValues(iss, &face.values);
+  const auto parse_count = ParseValues<OptionsT>(is, &face.values, status);
+  if (!status->ok()) {
+    return false;
+  }
 
   // Works for both std::array and std::vector.
   // This is never an issue for polygons.
-  if (parse_count != face.values.size()) {
-    auto oss = std::ostringstream{};
-    oss << "expected " << face.values.size() << " face indices (found "
-        << parse_count << ")";
-    throw std::runtime_error(oss.str());
+  if (OptionsT::kCheckCounts && parse_count != face.values.size()) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kFaceIndexCount, face.values.size(),
+        parse_count);
   }
 
-  ValidateFace(face, typename FaceTraits<ParseType>::FaceCategory{});
+  if (OptionsT::kValidate &&
+      !ValidateFace(face, typename FaceTraits<ParseType>::FaceCategory{},
+                    status)) {
+    return false;
+  }
   add_face.func(face);
   ++(*count);
+  return true;
+}
+
+template <typename AddFaceFuncT, typename IndexT>
+void TriangulateFace(AddFaceFuncT& add_face, const IndexT* const indices,
+                     const std::size_t index_count,
+                     std::uint64_t* const count) {
+  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  add_face.triangulator(
+      indices, index_count,
+      [&add_face, count](const IndexT& i0, const IndexT& i1,
+                         const IndexT& i2) {
+        add_face.func(ParseType(i0, i1, i2));
+        ++(*count);
+      });
+}
+
+template <typename OptionsT, typename AddFaceFuncT>
+bool ParseFace(LineStream* const is, 
+               AddFaceFuncT&& add_face,
+               std::uint64_t* const count,
+               ObjReadStatus* const status,
+               TriangulateFaceTag) {
+  using IndexType = typename std::decay<AddFaceFuncT>::type::IndexType;
+
+  // Indices of typical faces fit without heap allocations.
+  auto indices = SmallVector<IndexType, 16>{};
+  const auto parse_count = ParseValues<OptionsT>(is, &indices, status);
+  if (!status->ok()) {
+    return false;
+  }
+
+  if (OptionsT::kValidate && parse_count < 3) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kPolygonIndexCount, 3, parse_count);
+  }
+
+  TriangulateFace(add_face, indices.data(), indices.size(), count);
+  return true;
 }
 
-template <typename AddObjTexCoordFuncT>
-void ParseObjTexCoord(std::istringstream* const iss,
+template <typename OptionsT, typename AddObjTexCoordFuncT>
+bool ParseObjTexCoord(LineStream* const is,
                    AddObjTexCoordFuncT&& add_tex_coord, 
-                   std::uint32_t* const count,
+                   std::uint64_t* const count,
+                   ObjReadStatus* const status,
                    FuncTag) {
   using ParseType = typename std::decay<AddObjTexCoordFuncT>::type::ParseType;
   static_assert(IsObjTexCoord<ParseType>::value,
                 "parse type must be a ObjTexCoord type");
 
   auto tex_coord = ParseType{};
-  const auto parse_count = ParseValues(iss, &tex_coord.values);
+  const auto parse_count = ParseValues<OptionsT>(is, &tex_coord.values, status);
+  if (!status->ok()) {
+    return false;
+  }
 
-  if (parse_count < 2) {
-    auto oss = std::ostringstream{};
-    oss << "texture coordinates must have 2 or 3 values (found " << parse_count
-        << ")";
-    throw std::runtime_error(oss.str());
+  if (OptionsT::kCheckCounts && parse_count < 2) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kTexCoordValueCount, 2, parse_count);
   }
 
   // Third texture coordinate value (if any) defaults to 1.
@@ -551,282 +1681,2995 @@ void ParseObjTexCoord(std::istringstream* const iss,
     tex_coord.values[2] = typename ArrayType::value_type{1};
   }
 
-  ValidateObjTexCoord(tex_coord);
+  if (OptionsT::kValidate && !ValidateObjTexCoord(tex_coord, status)) {
+    return false;
+  }
   add_tex_coord.func(tex_coord);
   ++(*count);
+  return true;
 }
 
 // Dummy.
-template <typename AddObjTexCoordFuncT>
-void ParseObjTexCoord(std::istringstream* const, AddObjTexCoordFuncT&&,
-                   std::uint32_t* const, NoOpFuncTag) {}
+template <typename OptionsT, typename AddObjTexCoordFuncT>
+bool ParseObjTexCoord(LineStream* const, AddObjTexCoordFuncT&&,
+                   std::uint64_t* const, ObjReadStatus* const, NoOpFuncTag) {
+  return true;
+}
 
-template <typename AddNormalFuncT>
-void ParseNormal(std::istringstream* const iss, 
+template <typename OptionsT, typename AddNormalFuncT>
+bool ParseNormal(LineStream* const is, 
                  AddNormalFuncT&& add_normal,
-                 std::uint32_t* const count, 
+                 std::uint64_t* const count, 
+                 ObjReadStatus* const status,
                  FuncTag) {
   using ParseType = typename std::decay<AddNormalFuncT>::type::ParseType;
   static_assert(IsNormal<ParseType>::value, "parse type must be a ObjNormal type");
 
   auto normal = ParseType{};
-  const auto parse_count = ParseValues(iss, &normal.values);
+  const auto parse_count = ParseValues<OptionsT>(is, &normal.values, status);
+  if (!status->ok()) {
+    return false;
+  }
 
-  if (parse_count < 3) {
-    auto oss = std::ostringstream{};
-    oss << "normals must have 3 values (found " << parse_count << ")";
-    throw std::runtime_error(oss.str());
+  if (OptionsT::kCheckCounts && parse_count < 3) {
+    return StatusAccess::SetCountError(
+        status, ObjReadErrorCode::kNormalValueCount, 3, parse_count);
   }
 
   add_normal.func(normal);
   ++(*count);
+  return true;
 }
 
 // Dummy.
-template <typename AddNormalFuncT>
-void ParseNormal(std::istringstream* const, AddNormalFuncT&&,
-                 std::uint32_t* const, NoOpFuncTag) {}
+template <typename OptionsT, typename AddNormalFuncT>
+bool ParseNormal(LineStream* const, AddNormalFuncT&&,
+                 std::uint64_t* const, ObjReadStatus* const, NoOpFuncTag) {
+  return true;
+}
 
-template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
-          typename AddNormalFuncT, typename AddFaceFuncT>
-void ParseLine(const std::string& line, 
+inline int CountTrailingZeros(const std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<int>(index);
+#else
+  auto n = 0;
+  for (auto y = x; (y & 1) == 0; y >>= 1) {
+    ++n;
+  }
+  return n;
+#endif
+}
+
+// Splits a buffer into lines. Newlines are located 64 bytes at a time and
+// recorded as bits in a mask, so that finding the next line is a bit scan
+// rather than a byte-by-byte search.
+class LineScanner {
+ public:
+  static constexpr std::size_t kBlockSize = 64;
+
+  LineScanner(const char* const first, const char* const last)
+      : block_(first),
+        last_(last),
+        line_begin_(first),
+        newline_mask_(first != last ? NewlineMask(first, last) : 0) {}
+
+  // Returns false when there are no more lines. The newline character is
+  // not included in the line.
+  bool Next(const char** const line_begin, const char** const line_end) {
+    while (newline_mask_ == 0) {
+      // Check the remaining size before advancing, so that block_ never
+      // points past the end of the buffer.
+      if (static_cast<std::size_t>(last_ - block_) <= kBlockSize) {
+        // Last line has no newline.
+        if (line_begin_ == last_) {
+          return false;
+        }
+        *line_begin = line_begin_;
+        *line_end = last_;
+        line_begin_ = last_;
+        return true;
+      }
+      block_ += kBlockSize;
+      newline_mask_ = NewlineMask(block_, last_);
+    }
+
+    *line_begin = line_begin_;
+    *line_end = block_ + CountTrailingZeros(newline_mask_);
+    newline_mask_ &= newline_mask_ - 1;  // Clear lowest set bit.
+    line_begin_ = *line_end + 1;
+    return true;
+  }
+
+ private:
+  // Bit i is set if block[i] is a newline.
+  static std::uint64_t NewlineMask(const char* const block,
+                                   const char* const last) {
+    if (static_cast<std::size_t>(last - block) < kBlockSize) {
+      auto mask = std::uint64_t{0};
+      for (auto i = std::size_t{0}; block + i != last; ++i) {
+        mask |= static_cast<std::uint64_t>(block[i] == '\n') << i;
+      }
+      return mask;
+    }
+
+#if defined(THINKS_OBJ_IO_AVX2)
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const auto hi =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    const auto lo_mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)));
+    const auto hi_mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+    return (static_cast<std::uint64_t>(hi_mask) << 32) | lo_mask;
+#elif defined(THINKS_OBJ_IO_SSE2)
+    const auto newline = _mm_set1_epi8('\n');
+    auto mask = std::uint64_t{0};
+    for (auto i = 0; i < 4; ++i) {
+      const auto v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+      const auto m = static_cast<std::uint16_t>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+      mask |= static_cast<std::uint64_t>(m) << (16 * i);
+    }
+    return mask;
+#else
+    auto mask = std::uint64_t{0};
+    for (auto i = std::size_t{0}; i < kBlockSize; ++i) {
+      mask |= static_cast<std::uint64_t>(block[i] == '\n') << i;
+    }
+    return mask;
+#endif
+  }
+
+  const char* block_;
+  const char* const last_;
+  const char* line_begin_;
+  std::uint64_t newline_mask_;
+};
+
+// The first token on a line. Supporting a new prefix (e.g. "o", "g",
+// "usemtl" or "l") means adding an enumerator and a case in
+// ClassifyLinePrefix.
+enum class LinePrefix : std::uint8_t {
+  kEmpty,
+  kComment,
+  kPosition,
+  kFace,
+  kTexCoord,
+  kNormal,
+  kUnknown
+};
+
+// Classifies the prefix token [first, last) by its size and first bytes,
+// without comparing whole strings.
+inline LinePrefix ClassifyLinePrefix(const char* const first,
+                                     const char* const last) noexcept {
+  switch (last - first) {
+    case 0:
+      return LinePrefix::kEmpty;
+    case 1:
+      switch (first[0]) {
+        case CommentPrefix()[0]:
+          return LinePrefix::kComment;
+        case PositionPrefix()[0]:
+          return LinePrefix::kPosition;
+        case FacePrefix()[0]:
+          return LinePrefix::kFace;
+        default:
+          break;
+      }
+      break;
+    case 2:
+      if (first[0] == PositionPrefix()[0]) {
+        switch (first[1]) {
+          case ObjTexCoordPrefix()[1]:
+            return LinePrefix::kTexCoord;
+          case NormalPrefix()[1]:
+            return LinePrefix::kNormal;
+          default:
+            break;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  return LinePrefix::kUnknown;
+}
+
+// Counts elements on a line by looking only at its prefix. For faces the
+// number of indices is counted as the number of tokens after the prefix.
+// No values are parsed or validated and unrecognized lines are ignored.
+inline void CountLine(const char* const first,
+                      const char* const last,
+                      std::uint64_t* const position_count,
+                      std::uint64_t* const face_count,
+                      std::uint64_t* const tex_coord_count,
+                      std::uint64_t* const normal_count,
+                      std::uint64_t* const face_index_count) {
+  const auto prefix_begin = FindTokenBegin(first, last);
+  const auto prefix_end = FindTokenEnd(prefix_begin, last);
+  switch (ClassifyLinePrefix(prefix_begin, prefix_end)) {
+    case LinePrefix::kPosition:
+      ++(*position_count);
+      break;
+    case LinePrefix::kFace: {
+      ++(*face_count);
+      auto token_begin = FindTokenBegin(prefix_end, last);
+      while (token_begin != last) {
+        ++(*face_index_count);
+        token_begin = FindTokenBegin(FindTokenEnd(token_begin, last), last);
+      }
+      break;
+    }
+    case LinePrefix::kTexCoord:
+      ++(*tex_coord_count);
+      break;
+    case LinePrefix::kNormal:
+      ++(*normal_count);
+      break;
+    default:
+      break;
+  }
+}
+
+template <typename AddUnknownLineFuncT>
+bool ParseUnknownLine(const char* const prefix_begin,
+                      const char* const prefix_end,
+                      const char* const line_end,
+                      AddUnknownLineFuncT&& add_unknown_line,
+                      ObjReadStatus* const, FuncTag) {
+  const auto rest_begin = FindTokenBegin(prefix_end, line_end);
+  auto rest_end = line_end;
+  while (rest_end != rest_begin && IsSpace(*(rest_end - 1))) {
+    --rest_end;
+  }
+
+  add_unknown_line.func(ObjUnknownLine{
+      prefix_begin, static_cast<std::size_t>(prefix_end - prefix_begin),
+      rest_begin, static_cast<std::size_t>(rest_end - rest_begin)});
+  return true;
+}
+
+// Without an add function unknown lines are errors.
+template <typename AddUnknownLineFuncT>
+bool ParseUnknownLine(const char* const prefix_begin,
+                      const char* const prefix_end, const char* const,
+                      AddUnknownLineFuncT&&, ObjReadStatus* const status,
+                      NoOpFuncTag) {
+  return StatusAccess::SetError(
+      status, ObjReadErrorCode::kUnrecognizedLinePrefix, prefix_begin,
+      prefix_end);
+}
+
+template <typename OptionsT, typename AddPositionFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT,
+          typename AddFaceFuncT, typename AddUnknownLineFuncT>
+bool ParseLine(LineStream* const is,
                AddPositionFuncT&& add_position,
                AddFaceFuncT&& add_face, 
                AddObjTexCoordFuncT&& add_tex_coord,
                AddNormalFuncT&& add_normal, 
-               std::uint32_t* const position_count,
-               std::uint32_t* const face_count,
-               std::uint32_t* const tex_coord_count,
-               std::uint32_t* const normal_count) {
-  auto iss = std::istringstream(line);
-
+               AddUnknownLineFuncT&& add_unknown_line,
+               std::uint64_t* const position_count,
+               std::uint64_t* const face_count,
+               std::uint64_t* const tex_coord_count,
+               std::uint64_t* const normal_count,
+               ObjReadStatus* const status) {
   // Prefix is first non-whitespace token.
-  auto prefix = std::string{};
-  iss >> prefix;
+  const auto prefix_begin = FindTokenBegin(is->position(), is->end());
+  const auto prefix_end = FindTokenEnd(prefix_begin, is->end());
+  is->Seek(prefix_end);
 
   // Parse the rest of the line depending on prefix.
-  if (prefix.empty() || prefix == CommentPrefix()) {
-    return;  // Ignore empty lines and comments.
-  } else if (prefix == PositionPrefix()) {
-    ParsePosition(&iss, std::forward<AddPositionFuncT>(add_position),
-                  position_count);
-  } else if (prefix == FacePrefix()) {
-    ParseFace(&iss, std::forward<AddFaceFuncT>(add_face), face_count);
-  } else if (prefix == ObjTexCoordPrefix()) {
-    ParseObjTexCoord(&iss, std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-                     tex_coord_count,
-                     typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
-  } else if (prefix == NormalPrefix()) {
-    ParseNormal(&iss, std::forward<AddNormalFuncT>(add_normal), normal_count,
-                typename FuncTraits<AddNormalFuncT>::FuncCategory{});
-  } else {
-    auto oss = std::ostringstream{};
-    oss << "unrecognized line prefix '" << prefix << "'";
-    throw std::runtime_error(oss.str());
+  switch (ClassifyLinePrefix(prefix_begin, prefix_end)) {
+    case LinePrefix::kEmpty:
+    case LinePrefix::kComment:
+      break;  // Ignore empty lines and comments.
+    case LinePrefix::kPosition:
+      return ParsePosition<OptionsT>(
+          is, std::forward<AddPositionFuncT>(add_position), position_count,
+          status);
+    case LinePrefix::kFace:
+      return ParseFace<OptionsT>(
+          is, std::forward<AddFaceFuncT>(add_face), face_count, status,
+          typename FaceFuncTraits<AddFaceFuncT>::FaceFuncCategory{});
+    case LinePrefix::kTexCoord:
+      return ParseObjTexCoord<OptionsT>(
+          is, std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+          tex_coord_count, status,
+          typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
+    case LinePrefix::kNormal:
+      return ParseNormal<OptionsT>(
+          is, std::forward<AddNormalFuncT>(add_normal), normal_count, status,
+          typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+    case LinePrefix::kUnknown:
+      return ParseUnknownLine(
+          prefix_begin, prefix_end, is->end(),
+          std::forward<AddUnknownLineFuncT>(add_unknown_line), status,
+          typename FuncTraits<AddUnknownLineFuncT>::FuncCategory{});
   }
+  return true;
 }
 
-template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
-          typename AddNormalFuncT, typename AddFaceFuncT>
-void ParseLines(std::istream& is, 
+// Parsing stops at the first error, which is recorded in status along
+// with its location.
+template <typename OptionsT, typename AddPositionFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT,
+          typename AddFaceFuncT, typename AddUnknownLineFuncT>
+bool ParseLines(std::istream& is, 
                 AddPositionFuncT&& add_position,
                 AddFaceFuncT&& add_face, 
                 AddObjTexCoordFuncT&& add_tex_coord,
                 AddNormalFuncT&& add_normal,
-                std::uint32_t* const position_count,
-                std::uint32_t* const face_count,
-                std::uint32_t* const tex_coord_count,
-                std::uint32_t* const normal_count) {
+                AddUnknownLineFuncT&& add_unknown_line,
+                std::uint64_t* const position_count,
+                std::uint64_t* const face_count,
+                std::uint64_t* const tex_coord_count,
+                std::uint64_t* const normal_count,
+                ObjReadStatus* const status) {
+  // Line storage is re-used, so allocations only happen when
+  // a line is longer than any previous line.
   auto line = std::string{};
+  LineStream line_stream;
+  auto line_number = std::uint64_t{0};
+  auto byte_offset = std::uint64_t{0};
   while (std::getline(is, line)) {
-    obj_io_internal::read::ParseLine(
-        line, 
-        std::forward<AddPositionFuncT>(add_position),
-        std::forward<AddFaceFuncT>(add_face),
-        std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-        std::forward<AddNormalFuncT>(add_normal), 
-        position_count, face_count,
-        tex_coord_count, normal_count);
+    ++line_number;
+    line_stream.Reset(line.data(), line.data() + line.size());
+    if (!obj_io_internal::read::ParseLine<OptionsT>(
+            &line_stream, 
+            std::forward<AddPositionFuncT>(add_position),
+            std::forward<AddFaceFuncT>(add_face),
+            std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+            std::forward<AddNormalFuncT>(add_normal), 
+            std::forward<AddUnknownLineFuncT>(add_unknown_line),
+            position_count, face_count,
+            tex_coord_count, normal_count, status)) {
+      StatusAccess::SetLocation(status, line_number, byte_offset);
+      return false;
+    }
+    byte_offset += line.size() + 1;  // Newline not included in line.
   }
+  return true;
 }
 
-}  // namespace read
+template <typename OptionsT, typename AddPositionFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT,
+          typename AddFaceFuncT, typename AddUnknownLineFuncT>
+bool ParseLines(const char* const data, 
+                const std::size_t size,
+                AddPositionFuncT&& add_position,
+                AddFaceFuncT&& add_face, 
+                AddObjTexCoordFuncT&& add_tex_coord,
+                AddNormalFuncT&& add_normal,
+                AddUnknownLineFuncT&& add_unknown_line,
+                std::uint64_t* const position_count,
+                std::uint64_t* const face_count,
+                std::uint64_t* const tex_coord_count,
+                std::uint64_t* const normal_count,
+                ObjReadStatus* const status) {
+  // Lines are parsed in place, the buffer is never copied.
+  auto line_begin = static_cast<const char*>(nullptr);
+  auto line_end = static_cast<const char*>(nullptr);
+  auto line_scanner = LineScanner(data, data + size);
+  LineStream line_stream;
+  auto line_number = std::uint64_t{0};
+  while (line_scanner.Next(&line_begin, &line_end)) {
+    ++line_number;
+    line_stream.Reset(line_begin, line_end);
+    if (!obj_io_internal::read::ParseLine<OptionsT>(
+            &line_stream, 
+            std::forward<AddPositionFuncT>(add_position),
+            std::forward<AddFaceFuncT>(add_face),
+            std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+            std::forward<AddNormalFuncT>(add_normal), 
+            std::forward<AddUnknownLineFuncT>(add_unknown_line),
+            position_count, face_count,
+            tex_coord_count, normal_count, status)) {
+      StatusAccess::SetLocation(status, line_number,
+                                static_cast<std::uint64_t>(line_begin - data));
+      return false;
+    }
+  }
+  return true;
+}
 
-namespace write {
+// Elements staged by a parallel read, in file order.
+struct NoElement {};
 
-template <typename IntT>
-std::ostream& operator<<(std::ostream& os, const ObjIndex<IntT>& index) {
-  using ValueType = decltype(index.value);
+enum class ElementKind : std::uint8_t {
+  kPosition,
+  kFace,
+  kTexCoord,
+  kNormal,
+  kUnknownLine
+};
 
-  // Note that the valid range allows increment of one.
-  if (!(ValueType{0} <= index.value &&
-        index.value < std::numeric_limits<ValueType>::max())) {
-    auto oss = std::ostringstream{};
-    oss << "invalid index: " << static_cast<std::int64_t>(index.value);
-    throw std::runtime_error(oss.str());
+template <typename AddFuncT,
+          typename FuncCategoryT = typename FuncTraits<AddFuncT>::FuncCategory>
+struct StagedType {
+  using Type = typename std::decay<AddFuncT>::type::ParseType;
+};
+
+template <typename AddFuncT>
+struct StagedType<AddFuncT, NoOpFuncTag> {
+  using Type = NoElement;
+};
+
+template <typename AddFaceFuncT,
+          typename FaceFuncCategoryT =
+              typename FaceFuncTraits<AddFaceFuncT>::FaceFuncCategory>
+struct StagedFaceType {
+  using Type = typename std::decay<AddFaceFuncT>::type::ParseType;
+};
+
+// Faces are triangulated on delivery, when preceding positions have been
+// added.
+template <typename AddFaceFuncT>
+struct StagedFaceType<AddFaceFuncT, TriangulateFaceTag> {
+  using Type = ObjSmallPolygonFace<
+      typename std::decay<AddFaceFuncT>::type::IndexType, 4>;
+};
+
+template <typename PositionT, typename FaceT, typename TexCoordT,
+          typename NormalT, typename UnknownLineT>
+struct StagedChunk {
+  std::vector<PositionT> positions;
+  std::vector<FaceT> faces;
+  std::vector<TexCoordT> tex_coords;
+  std::vector<NormalT> normals;
+  std::vector<UnknownLineT> unknown_lines;
+  std::vector<ElementKind> order;
+
+  // Set if parsing stopped early. Elements parsed before the error
+  // are still delivered.
+  ObjReadStatus status;
+  std::exception_ptr error;
+  bool done = false;
+};
+
+template <typename T>
+class StageElementFunc {
+ public:
+  StageElementFunc(std::vector<T>* const elements,
+                   std::vector<ElementKind>* const order,
+                   const ElementKind kind) noexcept
+      : elements_(elements), order_(order), kind_(kind) {}
+
+  void operator()(const T& element) const {
+    elements_->push_back(element);
+    order_->push_back(kind_);
   }
 
-  // Input indices are assumed to be zero-based.
-  // OBJ format uses one-based indexing.
-  os << index.value + 1;
-  return os;
+ private:
+  std::vector<T>* elements_;
+  std::vector<ElementKind>* order_;
+  ElementKind kind_;
+};
+
+template <typename T>
+ObjAddFunc<T, StageElementFunc<T>> MakeStageFunc(
+    std::vector<T>* const elements, std::vector<ElementKind>* const order,
+    const ElementKind kind, FuncTag) {
+  return {StageElementFunc<T>(elements, order, kind)};
 }
 
-template <typename IntT>
-std::ostream& operator<<(std::ostream& os,
-                         const ObjIndexGroup<IntT>& index_group) {
-  os << index_group.position_index;
-  if (index_group.tex_coord_index.second && index_group.normal_index.second) {
-    os << IndexGroupSeparator() << index_group.tex_coord_index.first
-       << IndexGroupSeparator() << index_group.normal_index.first;
-  } else if (index_group.tex_coord_index.second) {
-    os << IndexGroupSeparator() << index_group.tex_coord_index.first;
-  } else if (index_group.normal_index.second) {
-    os << IndexGroupSeparator() << IndexGroupSeparator()
-       << index_group.normal_index.first;
-  }
-  return os;
+// Dummy.
+template <typename T>
+std::nullptr_t MakeStageFunc(std::vector<T>* const,
+                             std::vector<ElementKind>* const,
+                             const ElementKind, NoOpFuncTag) {
+  return nullptr;
 }
 
-inline void WriteHeader(std::ostream& os, const std::string& newline) {
-  os << CommentPrefix() << " Written by https://github.com/thinks/obj-io"
-     << newline;
+template <typename AddFuncT, typename T>
+void DeliverElement(AddFuncT&& add_func, const T& element,
+                    std::uint64_t* const count, FuncTag) {
+  add_func.func(element);
+  ++(*count);
 }
 
-template <template <typename> class MappedTypeCheckerT, typename MapperT,
-          typename ValidatorT>
-std::uint32_t WriteMappedLines(std::ostream& os, const std::string& line_prefix,
-                               MapperT&& mapper, ValidatorT validator,
-                               const std::string& newline) {
-  auto count = std::uint32_t{0};
-  auto map_result = mapper();
-  while (!map_result.is_end) {
-    static_assert(MappedTypeCheckerT<decltype(map_result.value)>::value,
-                  "incorrect mapped type");
+// Dummy.
+template <typename AddFuncT, typename T>
+void DeliverElement(AddFuncT&&, const T&, std::uint64_t* const,
+                    NoOpFuncTag) {}
+
+template <typename AddFaceFuncT, typename FaceT>
+void DeliverFace(AddFaceFuncT&& add_face, const FaceT& face,
+                 std::uint64_t* const count, ParseFaceTag) {
+  DeliverElement(add_face, face, count, FuncTag{});
+}
 
-    validator(map_result.value);
+template <typename AddFaceFuncT, typename FaceT>
+void DeliverFace(AddFaceFuncT&& add_face, const FaceT& face,
+                 std::uint64_t* const count, TriangulateFaceTag) {
+  TriangulateFace(add_face, face.values.data(), face.values.size(), count);
+}
 
-    // Write line.
-    os << line_prefix;
-    for (const auto& element : map_result.value.values) {
-      os << " " << element;
+// Splits [first, last) into at most chunk_count ranges of roughly equal
+// size that end just after a newline (or at last).
+inline std::vector<std::pair<const char*, const char*>> SplitLines(
+    const char* const first, const char* const last,
+    const std::size_t chunk_count) {
+  auto ranges = std::vector<std::pair<const char*, const char*>>{};
+  const auto size = static_cast<std::size_t>(last - first);
+  auto range_begin = first;
+  for (auto i = std::size_t{1}; i < chunk_count && range_begin != last; ++i) {
+    const auto split = first + size / chunk_count * i;
+    if (split < range_begin) {
+      continue;  // Previous range ended on a very long line.
     }
-    os << newline;
-
-    ++count;
+    const auto newline = static_cast<const char*>(
+        std::memchr(split, '\n', static_cast<std::size_t>(last - split)));
+    const auto range_end = newline == nullptr ? last : newline + 1;
+    ranges.emplace_back(range_begin, range_end);
+    range_begin = range_end;
+  }
+  if (range_begin != last) {
+    ranges.emplace_back(range_begin, last);
+  }
+  return ranges;
+}
+
+// Joins threads when going out of scope, also during stack unwinding.
+class ThreadJoiner {
+ public:
+  explicit ThreadJoiner(std::vector<std::thread>* const threads) noexcept
+      : threads_(threads) {}
+
+  ~ThreadJoiner() {
+    for (auto& thread : *threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+
+  ThreadJoiner(const ThreadJoiner&) = delete;
+  ThreadJoiner& operator=(const ThreadJoiner&) = delete;
+
+ private:
+  std::vector<std::thread>* threads_;
+};
+
+// Parses chunks of lines on worker threads into staging buffers. The
+// calling thread delivers staged elements to the add functions in file
+// order, so that callbacks are never invoked concurrently and see the same
+// sequence of calls as a serial read. Workers run at most a few chunks
+// ahead of delivery, which bounds the staging memory.
+template <typename OptionsT, typename AddPositionFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT,
+          typename AddFaceFuncT, typename AddUnknownLineFuncT>
+void ParseLinesParallel(const char* const data, 
+                        const std::size_t size,
+                        const std::uint32_t thread_count,
+                        AddPositionFuncT&& add_position,
+                        AddFaceFuncT&& add_face,
+                        AddObjTexCoordFuncT&& add_tex_coord,
+                        AddNormalFuncT&& add_normal,
+                        AddUnknownLineFuncT&& add_unknown_line,
+                        std::uint64_t* const position_count,
+                        std::uint64_t* const face_count,
+                        std::uint64_t* const tex_coord_count,
+                        std::uint64_t* const normal_count,
+                        ObjReadStatus* const status) {
+  using PositionFuncCategory =
+      typename FuncTraits<AddPositionFuncT>::FuncCategory;
+  using TexCoordFuncCategory =
+      typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory;
+  using NormalFuncCategory = typename FuncTraits<AddNormalFuncT>::FuncCategory;
+  using UnknownLineFuncCategory =
+      typename FuncTraits<AddUnknownLineFuncT>::FuncCategory;
+  using ChunkType =
+      StagedChunk<typename StagedType<AddPositionFuncT>::Type,
+                  typename StagedFaceType<AddFaceFuncT>::Type,
+                  typename StagedType<AddObjTexCoordFuncT>::Type,
+                  typename StagedType<AddNormalFuncT>::Type,
+                  typename StagedType<AddUnknownLineFuncT>::Type>;
+
+  // A few chunks per thread evens out differences in parse cost,
+  // but very small chunks are not worth the overhead. Large inputs are
+  // split into more chunks, so that staged chunks stay small.
+  constexpr auto kChunksPerThread = std::size_t{4};
+  constexpr auto kMinChunkSize = std::size_t{1} << 16;
+  constexpr auto kMaxChunkSize = std::size_t{1} << 22;
+  const auto chunk_count = std::max(
+      {std::size_t{1},
+       std::min(thread_count * kChunksPerThread, size / kMinChunkSize),
+       size / kMaxChunkSize});
+  const auto max_staged_count = 2 * std::size_t{thread_count};
+  const auto ranges = SplitLines(data, data + size, chunk_count);
+  if (thread_count < 2 || ranges.size() < 2) {
+    ParseLines<OptionsT>(
+        data, size, std::forward<AddPositionFuncT>(add_position),
+               std::forward<AddFaceFuncT>(add_face),
+               std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+               std::forward<AddNormalFuncT>(add_normal),
+               std::forward<AddUnknownLineFuncT>(add_unknown_line),
+               position_count, face_count, tex_coord_count, normal_count,
+               status);
+    return;
+  }
+
+  auto chunks = std::vector<ChunkType>(ranges.size());
+  auto unknown_line_count = std::uint64_t{0};
+  std::mutex mutex;
+  std::condition_variable chunk_done;
+  std::condition_variable chunk_delivered;
+  auto next_chunk = std::size_t{0};
+  auto delivered_count = std::size_t{0};
+  auto cancel = false;
+
+  const auto stop_workers = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      cancel = true;
+    }
+    chunk_delivered.notify_all();
+  };
+
+  // Chunks are claimed in file order, so all chunks before a failed
+  // chunk are always parsed. A chunk is only claimed when fewer than
+  // max_staged_count chunks await delivery.
+  const auto claim_chunk = [&](std::size_t* const i) {
+    std::unique_lock<std::mutex> lock(mutex);
+    chunk_delivered.wait(lock, [&]() {
+      return cancel || next_chunk < delivered_count + max_staged_count;
+    });
+    if (cancel || next_chunk == chunks.size()) {
+      return false;
+    }
+    *i = next_chunk++;
+    return true;
+  };
+
+  const auto parse_chunks = [&]() {
+    auto i = std::size_t{0};
+    while (claim_chunk(&i)) {
+      auto& chunk = chunks[i];
+      auto dummy_count = std::uint64_t{0};
+      try {
+        const auto ok = ParseLines<OptionsT>(
+            ranges[i].first,
+            static_cast<std::size_t>(ranges[i].second - ranges[i].first),
+            MakeStageFunc(&chunk.positions, &chunk.order,
+                          ElementKind::kPosition, PositionFuncCategory{}),
+            MakeStageFunc(&chunk.faces, &chunk.order, ElementKind::kFace,
+                          FuncTag{}),
+            MakeStageFunc(&chunk.tex_coords, &chunk.order,
+                          ElementKind::kTexCoord, TexCoordFuncCategory{}),
+            MakeStageFunc(&chunk.normals, &chunk.order, ElementKind::kNormal,
+                          NormalFuncCategory{}),
+            MakeStageFunc(&chunk.unknown_lines, &chunk.order,
+                          ElementKind::kUnknownLine,
+                          UnknownLineFuncCategory{}),
+            &dummy_count, &dummy_count, &dummy_count, &dummy_count,
+            &chunk.status);
+        if (!ok) {
+          stop_workers();
+        }
+      } catch (...) {
+        chunk.error = std::current_exception();
+        stop_workers();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunk.done = true;
+      }
+      chunk_done.notify_one();
+    }
+  };
+
+  auto threads = std::vector<std::thread>{};
+  const ThreadJoiner joiner(&threads);
+  try {
+    for (auto i = std::uint32_t{0}; i < thread_count; ++i) {
+      threads.emplace_back(parse_chunks);
+    }
+
+    for (auto i = std::size_t{0}; i < chunks.size(); ++i) {
+      auto& chunk = chunks[i];
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunk_done.wait(lock, [&chunk]() { return chunk.done; });
+      }
+
+      auto position_iter = chunk.positions.cbegin();
+      auto face_iter = chunk.faces.cbegin();
+      auto tex_coord_iter = chunk.tex_coords.cbegin();
+      auto normal_iter = chunk.normals.cbegin();
+      auto unknown_line_iter = chunk.unknown_lines.cbegin();
+      for (const auto kind : chunk.order) {
+        switch (kind) {
+          case ElementKind::kPosition:
+            DeliverElement(add_position, *position_iter++, position_count,
+                           PositionFuncCategory{});
+            break;
+          case ElementKind::kFace:
+            DeliverFace(
+                add_face, *face_iter++, face_count,
+                typename FaceFuncTraits<AddFaceFuncT>::FaceFuncCategory{});
+            break;
+          case ElementKind::kTexCoord:
+            DeliverElement(add_tex_coord, *tex_coord_iter++, tex_coord_count,
+                           TexCoordFuncCategory{});
+            break;
+          case ElementKind::kNormal:
+            DeliverElement(add_normal, *normal_iter++, normal_count,
+                           NormalFuncCategory{});
+            break;
+          case ElementKind::kUnknownLine:
+            DeliverElement(add_unknown_line, *unknown_line_iter++,
+                           &unknown_line_count, UnknownLineFuncCategory{});
+            break;
+        }
+      }
+
+      if (chunk.error) {
+        std::rethrow_exception(chunk.error);
+      }
+      if (!chunk.status.ok()) {
+        // Locations are relative to the chunk, only count preceding lines
+        // when needed.
+        StatusAccess::AddLocation(
+            &chunk.status,
+            static_cast<std::uint64_t>(std::count(data, ranges[i].first, '\n')),
+            static_cast<std::uint64_t>(ranges[i].first - data));
+        *status = chunk.status;
+        stop_workers();
+        return;
+      }
+
+      // Release staging memory as soon as possible.
+      chunk = ChunkType{};
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++delivered_count;
+      }
+      chunk_delivered.notify_all();
+    }
+  } catch (...) {
+    stop_workers();
+    throw;
+  }
+}
+
+#if defined(__linux__) && defined(THINKS_OBJ_IO_EXCEPTIONS)
+// Read-only memory mapping of an entire file. Pages are faulted in
+// from the page cache as the mapping is traversed, so no copies of the
+// file contents are made. Files that cannot be mapped, i.e. that are not
+// regular files, are read into a buffer.
+class MappedFile {
+ public:
+  explicit MappedFile(const char* const path) : data_(nullptr), size_(0) {
+    const auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      ThrowFileError("failed opening file", path);
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) == -1) {
+      const auto err = errno;
+      ::close(fd);
+      errno = err;
+      ThrowFileError("failed reading size of file", path);
+    }
+    if (!S_ISREG(file_stat.st_mode)) {
+      // Pipes, FIFOs and files in /proc report a size of zero and cannot
+      // be mapped, their contents are read into a buffer instead.
+      ReadContents(fd, path);
+      ::close(fd);
+      return;
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+
+    // Mapping zero bytes is an error, empty files are simply empty buffers.
+    if (size_ > 0) {
+      const auto addr =
+          ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, /* offset */ 0);
+      if (addr == MAP_FAILED) {
+        const auto err = errno;
+        ::close(fd);
+        errno = err;
+        ThrowFileError("failed mapping file", path);
+      }
+      data_ = static_cast<const char*>(addr);
+
+      // The file is parsed front to back exactly once. This is only a
+      // hint to the kernel (aggressive read-ahead, early reclaim of
+      // pages behind the cursor), so failure is not an error.
+      ::madvise(addr, size_, MADV_SEQUENTIAL);
+    }
+
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr && buffer_.empty()) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  void ReadContents(const int fd, const char* const path) {
+    constexpr auto kChunkSize = std::size_t{1} << 16;
+    while (true) {
+      const auto offset = buffer_.size();
+      buffer_.resize(offset + kChunkSize);
+      const auto read_size = ::read(fd, buffer_.data() + offset, kChunkSize);
+      if (read_size == -1 && errno == EINTR) {
+        buffer_.resize(offset);
+        continue;
+      }
+      if (read_size == -1) {
+        const auto err = errno;
+        ::close(fd);
+        errno = err;
+        ThrowFileError("failed reading file", path);
+      }
+      buffer_.resize(offset + static_cast<std::size_t>(read_size));
+      if (read_size == 0) {
+        break;
+      }
+    }
+    if (!buffer_.empty()) {
+      data_ = buffer_.data();
+      size_ = buffer_.size();
+    }
+  }
+
+  [[noreturn]] static void ThrowFileError(const char* const what,
+                                          const char* const path) {
+    auto oss = std::ostringstream{};
+    oss << what << " '" << path << "' (" << std::strerror(errno) << ")";
+    throw std::runtime_error(oss.str());
+  }
+
+  const char* data_;
+  std::size_t size_;
+
+  // Contents of files that are not mapped.
+  std::vector<char> buffer_;
+};
+#endif  // defined(__linux__) && defined(THINKS_OBJ_IO_EXCEPTIONS)
+
+template <typename T>
+T ArrayValue(const T value) noexcept {
+  return value;
+}
+
+template <typename IntT>
+IntT ArrayValue(const ObjIndex<IntT>& index) noexcept {
+  return index.value;
+}
+
+// Only the position index of an index group is stored.
+template <typename IntT>
+IntT ArrayValue(const ObjIndexGroup<IntT>& index_group) noexcept {
+  return index_group.position_index.value;
+}
+
+// Copies the first N element values into a caller-provided array, further
+// values (e.g. the w of texture coordinates) are dropped. A null array only
+// counts elements.
+template <typename T, std::size_t N>
+class ArrayWriter {
+ public:
+  ArrayWriter(T* const data, const std::size_t capacity,
+              const char* const name) noexcept
+      : data_(data), capacity_(capacity), size_(0), name_(name) {}
+
+  template <typename ElementT>
+  void operator()(const ElementT& element) {
+    static_assert(std::tuple_size<decltype(element.values)>::value >= N,
+                  "element value count must be at least the array stride");
+    if (data_ == nullptr) {
+      return;
+    }
+
+    if (size_ == capacity_) {
+      auto oss = std::ostringstream{};
+      oss << name_ << " array capacity exceeded (capacity " << capacity_
+          << ")";
+      throw std::runtime_error(oss.str());
+    }
+
+    auto out = data_ + size_ * N;
+    for (auto i = std::size_t{0}; i < N; ++i) {
+      *out++ = ArrayValue(element.values[i]);
+    }
+    ++size_;
+  }
+
+ private:
+  T* data_;
+  std::size_t capacity_;
+  std::size_t size_;
+  const char* name_;
+};
+
+template <typename AddFuncT>
+void FlushAddFunc(AddFuncT&&) {}
+
+template <typename ParseT, typename Func>
+void FlushAddFunc(ObjAddBatchFunc<ParseT, Func>& add_func) {
+  add_func.func.Flush();
+}
+
+template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
+          typename AddNormalFuncT, typename AddFaceFuncT,
+          typename AddUnknownLineFuncT>
+void FlushAddFuncs(AddPositionFuncT& add_position, AddFaceFuncT& add_face,
+                   AddObjTexCoordFuncT& add_tex_coord,
+                   AddNormalFuncT& add_normal,
+                   AddUnknownLineFuncT& add_unknown_line) {
+  FlushAddFunc(add_position);
+  FlushAddFunc(add_face);
+  FlushAddFunc(add_tex_coord);
+  FlushAddFunc(add_normal);
+  FlushAddFunc(add_unknown_line);
+}
+
+}  // namespace read
+
+namespace write {
+
+// Collects written characters in a block that is passed on to the sink
+// when full, so that sinks see few large writes instead of one call per
+// token. Callers must call Flush when done.
+template <typename SinkT>
+class BlockWriter {
+ public:
+  static constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+
+  explicit BlockWriter(SinkT* const sink)
+      : sink_(sink), block_(kBlockSize), pos_(block_.data()) {}
+
+  BlockWriter(const BlockWriter&) = delete;
+  BlockWriter& operator=(const BlockWriter&) = delete;
+
+  void Write(const char* const data, const std::size_t size) {
+    if (size > Available()) {
+      Flush();
+      if (size > kBlockSize) {
+        sink_->Write(data, size);
+        return;
+      }
+    }
+    pos_ = std::copy(data, data + size, pos_);
+  }
+
+  void Write(const std::string& str) { Write(str.data(), str.size()); }
+
+  // Returns room for at least size characters, which must not exceed the
+  // block size. Characters are added by calling Commit with their end.
+  char* Reserve(const std::size_t size) {
+    if (size > Available()) {
+      Flush();
+    }
+    return pos_;
+  }
+
+  void Commit(char* const end) noexcept { pos_ = end; }
+
+  void Flush() {
+    if (pos_ != block_.data()) {
+      sink_->Write(block_.data(),
+                   static_cast<std::size_t>(pos_ - block_.data()));
+      pos_ = block_.data();
+    }
+  }
+
+ private:
+  std::size_t Available() const noexcept {
+    return static_cast<std::size_t>(block_.data() + kBlockSize - pos_);
+  }
+
+  SinkT* sink_;
+  std::vector<char> block_;
+  char* pos_;
+};
+
+class OStreamSink {
+ public:
+  explicit OStreamSink(std::ostream* const os) noexcept : os_(os) {}
+
+  void Write(const char* const data, const std::size_t size) {
+    os_->write(data, static_cast<std::streamsize>(size));
+  }
+
+ private:
+  std::ostream* os_;
+};
+
+class StringSink {
+ public:
+  explicit StringSink(std::string* const str) noexcept : str_(str) {}
+
+  void Write(const char* const data, const std::size_t size) {
+    str_->append(data, size);
+  }
+
+ private:
+  std::string* str_;
+};
+
+// Enough for the shortest representation of any float or double,
+// e.g. "-2.2250738585072014e-308".
+constexpr std::size_t kMaxFloatChars = 32;
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+
+// Writes the shortest characters that parse back to exactly value and
+// returns the end of the written characters.
+template <typename FloatT>
+char* FormatFloat(char* const first, const FloatT value) {
+  return std::to_chars(first, first + kMaxFloatChars, value).ptr;
+}
+
+#else
+
+inline bool ParsesBackTo(const char* const str, const float value) {
+  return std::strtof(str, nullptr) == value;
+}
+
+inline bool ParsesBackTo(const char* const str, const double value) {
+  return std::strtod(str, nullptr) == value;
+}
+
+// Decimal digits d0 d1 ... with the value d0.d1... * 10^exponent.
+struct DecimalDigits {
+  char digits[kMaxFloatChars];
+  int digit_count;
+  int exponent;
+};
+
+// Finds the fewest significant digits that parse back to exactly value,
+// i.e. the digits written by std::to_chars. Since more digits are always
+// at least as close, the digit count is found by binary search. A decimal
+// point other than '.' is skipped, std::snprintf and std::strtod follow the
+// same locale.
+template <typename FloatT>
+DecimalDigits ShortestDigits(const FloatT value) {
+  char buf[kMaxFloatChars];
+  auto lo = 1;
+  auto hi = std::numeric_limits<FloatT>::max_digits10;
+  while (lo < hi) {
+    const auto mid = lo + (hi - lo) / 2;
+    std::snprintf(buf, kMaxFloatChars, "%.*e", mid - 1,
+                  static_cast<double>(value));
+    if (ParsesBackTo(buf, value)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  std::snprintf(buf, kMaxFloatChars, "%.*e", lo - 1,
+                static_cast<double>(value));
+
+  // Format is "[-]d[.ddd]e(+|-)dd".
+  auto result = DecimalDigits{};
+  auto pos = buf + (buf[0] == '-' ? 1 : 0);
+  for (; *pos != 'e'; ++pos) {
+    if ('0' <= *pos && *pos <= '9') {
+      result.digits[result.digit_count++] = *pos;
+    }
+  }
+  result.exponent = static_cast<int>(std::strtol(pos + 1, nullptr, 10));
+  while (result.digit_count > 1 &&
+         result.digits[result.digit_count - 1] == '0') {
+    --result.digit_count;
+  }
+  return result;
+}
+
+// Writes the same characters as std::to_chars, i.e. the shortest digits
+// that parse back to exactly value, in fixed or scientific notation,
+// whichever is shorter (fixed if equal). Output is independent of locale
+// and language standard. Returns the end of the written characters.
+template <typename FloatT>
+char* FormatFloat(char* first, const FloatT value) {
+  if (!std::isfinite(value)) {
+    const auto size = std::snprintf(first, kMaxFloatChars, "%g",
+                                    static_cast<double>(value));
+    return first + size;
+  }
+
+  if (std::signbit(value)) {
+    *first++ = '-';
+  }
+  const auto d = ShortestDigits(value);
+  const auto digits = d.digits;
+  const auto n = d.digit_count;
+  const auto e = d.exponent;
+
+  // Sizes without sign, the exponent has at least two digits.
+  const auto abs_e = e < 0 ? -e : e;
+  const auto scientific_size =
+      n + (n > 1 ? 1 : 0) + 2 + (abs_e >= 100 ? 3 : 2);
+  const auto fixed_size = e >= 0 ? std::max(n, e + 1) + (n > e + 1 ? 1 : 0)
+                                 : 2 - e - 1 + n;
+
+  auto pos = first;
+  if (fixed_size <= scientific_size) {
+    if (n < e + 1) {
+      // Integer value. Of the representations with this many characters
+      // std::to_chars picks the closest, i.e. the exact value rather than
+      // the digits padded with zeros.
+      return pos + std::snprintf(pos, kMaxFloatChars, "%.0f",
+                                 std::fabs(static_cast<double>(value)));
+    }
+    if (e >= 0) {
+      for (auto i = 0; i < n; ++i) {
+        if (i == e + 1) {
+          *pos++ = '.';
+        }
+        *pos++ = digits[i];
+      }
+    } else {
+      *pos++ = '0';
+      *pos++ = '.';
+      pos = std::fill_n(pos, -e - 1, '0');
+      pos = std::copy(digits, digits + n, pos);
+    }
+    return pos;
+  }
+
+  *pos++ = digits[0];
+  if (n > 1) {
+    *pos++ = '.';
+    pos = std::copy(digits + 1, digits + n, pos);
+  }
+  *pos++ = 'e';
+  *pos++ = e < 0 ? '-' : '+';
+  if (abs_e >= 100) {
+    *pos++ = static_cast<char>('0' + abs_e / 100);
+  }
+  *pos++ = static_cast<char>('0' + abs_e / 10 % 10);
+  *pos++ = static_cast<char>('0' + abs_e % 10);
+  return pos;
+}
+
+#endif  // defined(__cpp_lib_to_chars)
+
+// Integers are written straight into the output, characters and bool
+// (which std::ostream formats differently) are not.
+template <typename T>
+struct IsFormattedInteger
+    : std::integral_constant<
+          bool, std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                    !std::is_same<T, char>::value &&
+                    !std::is_same<T, signed char>::value &&
+                    !std::is_same<T, unsigned char>::value &&
+                    !std::is_same<T, wchar_t>::value &&
+                    !std::is_same<T, char16_t>::value &&
+                    !std::is_same<T, char32_t>::value> {};
+
+// Other arithmetic types are formatted as by std::ostream.
+template <typename WriterT, typename T>
+typename std::enable_if<!IsFormattedInteger<T>::value>::type WriteValue(
+    WriterT* const out, const T& value) {
+  auto oss = std::ostringstream{};
+  oss << value;
+  out->Write(oss.str());
+}
+
+// Floating point values are written with round-trip precision, independent
+// of locale.
+template <typename WriterT>
+void WriteValue(WriterT* const out, const float value) {
+  out->Commit(FormatFloat(out->Reserve(kMaxFloatChars), value));
+}
+
+template <typename WriterT>
+void WriteValue(WriterT* const out, const double value) {
+  out->Commit(FormatFloat(out->Reserve(kMaxFloatChars), value));
+}
+
+// Writes the decimal digits of value two at a time, using a table of
+// digit pairs, and returns the end of the written characters.
+inline char* FormatUnsigned(char* const first, std::uint64_t value) {
+  static constexpr char kDigitPairs[] =
+      "0001020304050607080910111213141516171819"
+      "2021222324252627282930313233343536373839"
+      "4041424344454647484950515253545556575859"
+      "6061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+
+  // Digits are produced back to front.
+  char buf[20];
+  auto pos = buf + sizeof(buf);
+  while (value >= 100) {
+    const auto i = static_cast<std::size_t>(value % 100) * 2;
+    value /= 100;
+    pos -= 2;
+    pos[0] = kDigitPairs[i];
+    pos[1] = kDigitPairs[i + 1];
+  }
+  if (value >= 10) {
+    const auto i = static_cast<std::size_t>(value) * 2;
+    pos -= 2;
+    pos[0] = kDigitPairs[i];
+    pos[1] = kDigitPairs[i + 1];
+  } else {
+    *--pos = static_cast<char>('0' + value);
+  }
+  return std::copy(pos, buf + sizeof(buf), first);
+}
+
+// Room for a sign and 20 digits.
+constexpr std::size_t kMaxIntegerChars = 21;
+
+template <typename WriterT, typename IntT>
+typename std::enable_if<IsFormattedInteger<IntT>::value>::type WriteValue(
+    WriterT* const out, const IntT value) {
+  auto pos = out->Reserve(kMaxIntegerChars);
+  auto magnitude = static_cast<std::uint64_t>(value);
+  if (value < IntT{0}) {
+    // Also correct for the minimum value, since unsigned negation wraps.
+    *pos++ = '-';
+    magnitude = std::uint64_t{0} - magnitude;
+  }
+  out->Commit(FormatUnsigned(pos, magnitude));
+}
+
+// Writes a zero-based index as one-based.
+template <typename IntT>
+char* FormatIndex(char* const first, const ObjIndex<IntT>& index) {
+  using ValueType = decltype(index.value);
+
+  // Note that the valid range allows increment of one.
+  if (!(ValueType{0} <= index.value &&
+        index.value < std::numeric_limits<ValueType>::max())) {
+    auto oss = std::ostringstream{};
+    oss << "invalid index: " << static_cast<std::int64_t>(index.value);
+    throw std::runtime_error(oss.str());
+  }
+
+  // Input indices are assumed to be zero-based.
+  // OBJ format uses one-based indexing.
+  return FormatUnsigned(first, static_cast<std::uint64_t>(index.value) + 1);
+}
+
+// Index group layouts, i.e. "v", "v/vt", "v//vn" and "v/vt/vn".
+enum class IndexGroupLayout : std::uint8_t {
+  kPosition = 0,
+  kTexCoord = 1,
+  kNormal = 2,
+  kTexCoordNormal = 3
+};
+
+template <typename IntT>
+IndexGroupLayout Layout(const ObjIndexGroup<IntT>& index_group) noexcept {
+  return static_cast<IndexGroupLayout>(
+      (index_group.tex_coord_index.second ? 1 : 0) |
+      (index_group.normal_index.second ? 2 : 0));
+}
+
+template <IndexGroupLayout LayoutT, typename IntT>
+char* FormatIndexGroup(char* pos, const ObjIndexGroup<IntT>& index_group) {
+  constexpr auto kHasTexCoord = LayoutT == IndexGroupLayout::kTexCoord ||
+                                LayoutT == IndexGroupLayout::kTexCoordNormal;
+  constexpr auto kHasNormal = LayoutT == IndexGroupLayout::kNormal ||
+                              LayoutT == IndexGroupLayout::kTexCoordNormal;
+
+  pos = FormatIndex(pos, index_group.position_index);
+  if (kHasTexCoord || kHasNormal) {
+    *pos++ = *IndexGroupSeparator();
+  }
+  if (kHasTexCoord) {
+    pos = FormatIndex(pos, index_group.tex_coord_index.first);
+  }
+  if (kHasNormal) {
+    *pos++ = *IndexGroupSeparator();
+    pos = FormatIndex(pos, index_group.normal_index.first);
+  }
+  return pos;
+}
+
+// Room for a space and an index group with three 20-digit indices.
+constexpr std::size_t kMaxIndexGroupChars = 64;
+
+template <typename IntT>
+char* FormatIndexGroup(char* const pos,
+                       const ObjIndexGroup<IntT>& index_group) {
+  switch (Layout(index_group)) {
+    case IndexGroupLayout::kPosition:
+      return FormatIndexGroup<IndexGroupLayout::kPosition>(pos, index_group);
+    case IndexGroupLayout::kTexCoord:
+      return FormatIndexGroup<IndexGroupLayout::kTexCoord>(pos, index_group);
+    case IndexGroupLayout::kNormal:
+      return FormatIndexGroup<IndexGroupLayout::kNormal>(pos, index_group);
+    case IndexGroupLayout::kTexCoordNormal:
+      break;
+  }
+  return FormatIndexGroup<IndexGroupLayout::kTexCoordNormal>(pos,
+                                                             index_group);
+}
+
+template <typename WriterT, typename ValuesT, typename FormatFuncT>
+void WriteIndices(WriterT* const out, const ValuesT& values,
+                  FormatFuncT format) {
+  for (const auto& index : values) {
+    auto pos = out->Reserve(kMaxIndexGroupChars);
+    *pos++ = ' ';
+    out->Commit(format(pos, index));
+  }
+}
+
+// Tag dispatch for writing element values.
+struct ValueTag {};
+struct IndexTag {};
+struct IndexGroupTag {};
+
+template <typename T>
+struct ValueTraits {
+  using ValueCategory = ValueTag;
+};
+
+template <typename IntT>
+struct ValueTraits<ObjIndex<IntT>> {
+  using ValueCategory = IndexTag;
+};
+
+template <typename IntT>
+struct ValueTraits<ObjIndexGroup<IntT>> {
+  using ValueCategory = IndexGroupTag;
+};
+
+template <typename WriterT, typename ValuesT>
+void WriteValues(WriterT* const out, const ValuesT& values, ValueTag) {
+  for (const auto& value : values) {
+    out->Write(" ", 1);
+    WriteValue(out, value);
+  }
+}
+
+template <typename WriterT, typename ValuesT>
+void WriteValues(WriterT* const out, const ValuesT& values, IndexTag) {
+  WriteIndices(out, values, [](char* const pos, const auto& index) {
+    return FormatIndex(pos, index);
+  });
+}
+
+template <IndexGroupLayout LayoutT, typename WriterT, typename ValuesT>
+void WriteIndexGroups(WriterT* const out, const ValuesT& values) {
+  WriteIndices(out, values, [](char* const pos, const auto& index_group) {
+    return FormatIndexGroup<LayoutT>(pos, index_group);
+  });
+}
+
+// The layout is chosen once per face. Faces that mix layouts (which is
+// not valid OBJ) are written one index group at a time.
+template <typename WriterT, typename ValuesT>
+void WriteValues(WriterT* const out, const ValuesT& values, IndexGroupTag) {
+  if (values.begin() == values.end()) {
+    return;
+  }
+  const auto layout = Layout(*values.begin());
+  const auto same_layout =
+      std::all_of(values.begin(), values.end(),
+                  [layout](const auto& index_group) {
+                    return Layout(index_group) == layout;
+                  });
+  if (!same_layout) {
+    WriteIndices(out, values, [](char* const pos, const auto& index_group) {
+      return FormatIndexGroup(pos, index_group);
+    });
+    return;
+  }
+
+  switch (layout) {
+    case IndexGroupLayout::kPosition:
+      WriteIndexGroups<IndexGroupLayout::kPosition>(out, values);
+      break;
+    case IndexGroupLayout::kTexCoord:
+      WriteIndexGroups<IndexGroupLayout::kTexCoord>(out, values);
+      break;
+    case IndexGroupLayout::kNormal:
+      WriteIndexGroups<IndexGroupLayout::kNormal>(out, values);
+      break;
+    case IndexGroupLayout::kTexCoordNormal:
+      WriteIndexGroups<IndexGroupLayout::kTexCoordNormal>(out, values);
+      break;
+  }
+}
+
+template <typename WriterT>
+void WriteHeader(WriterT* const out, const std::string& newline) {
+  out->Write(CommentPrefix(), std::strlen(CommentPrefix()));
+  const auto text = " Written by https://github.com/thinks/obj-io";
+  out->Write(text, std::strlen(text));
+  out->Write(newline);
+}
+
+// Calls func for each mapped element, returns the number of elements.
+template <typename MapperT, typename Func>
+std::uint64_t ForEachMapped(MapperT&& mapper, Func&& func, ElementMapperTag) {
+  auto count = std::uint64_t{0};
+  auto map_result = mapper();
+  while (!map_result.is_end) {
+    func(map_result.value);
+    ++count;
     map_result = mapper();
   }
   return count;
 }
 
-template <typename MapperT>
-std::uint32_t WritePositions(std::ostream& os, MapperT&& mapper,
+template <typename MapperT, typename Func>
+std::uint64_t ForEachMapped(MapperT&& mapper, Func&& func, BatchMapperTag) {
+  using MapperType = typename std::decay<MapperT>::type;
+  constexpr auto kBatchSize = MapperType::kBatchSize;
+
+  auto count = std::uint64_t{0};
+  auto batch = std::vector<typename MapperType::MappedType>(kBatchSize);
+  while (true) {
+    const auto batch_count =
+        static_cast<std::size_t>(mapper.func(batch.data(), kBatchSize));
+    if (batch_count == 0) {
+      break;
+    }
+    if (batch_count > kBatchSize) {
+      auto oss = std::ostringstream{};
+      oss << "batch mapper returned too many elements: " << batch_count
+          << " (max " << kBatchSize << ")";
+      throw std::runtime_error(oss.str());
+    }
+
+    for (auto i = std::size_t{0}; i < batch_count; ++i) {
+      func(batch[i]);
+    }
+    count += batch_count;
+  }
+  return count;
+}
+
+template <template <typename> class MappedTypeCheckerT, typename WriterT,
+          typename MapperT, typename ValidatorT>
+std::uint64_t WriteMappedLines(WriterT* const out,
+                               const std::string& line_prefix,
+                               MapperT&& mapper, ValidatorT validator,
+                               const std::string& newline) {
+  static_assert(
+      MappedTypeCheckerT<typename MapperTraits<MapperT>::MappedType>::value,
+      "incorrect mapped type");
+
+  return ForEachMapped(
+      std::forward<MapperT>(mapper),
+      [out, &line_prefix, &validator, &newline](const auto& value) {
+        validator(value);
+
+        // Write line.
+        out->Write(line_prefix);
+        using ValuesType = decltype(value.values);
+        WriteValues(out, value.values,
+                    typename ValueTraits<
+                        typename ValuesType::value_type>::ValueCategory{});
+        out->Write(newline);
+      },
+      typename MapperTraits<MapperT>::MapperCategory{});
+}
+
+template <typename WriterT, typename MapperT>
+std::uint64_t WritePositions(WriterT* const out, MapperT&& mapper,
                              const std::string& newline) {
-  return WriteMappedLines<IsPosition>(os, PositionPrefix(),
+  return WriteMappedLines<IsPosition>(out, PositionPrefix(),
                                       std::forward<MapperT>(mapper),
                                       [](const auto&) {},  // No validation.
                                       newline);
 }
 
-template <typename MapperT>
-std::uint32_t WriteObjTexCoords(std::ostream& os, MapperT&& mapper,
+template <typename WriterT, typename MapperT>
+std::uint64_t WriteObjTexCoords(WriterT* const out, MapperT&& mapper,
                                 const std::string& newline, FuncTag) {
   return WriteMappedLines<IsObjTexCoord>(
-      os, ObjTexCoordPrefix(), std::forward<MapperT>(mapper),
+      out, ObjTexCoordPrefix(), std::forward<MapperT>(mapper),
       [](const auto& tex_coord) { ValidateObjTexCoord(tex_coord); }, newline);
 }
 
 // Dummy.
-template <typename MapperT>
-std::uint32_t WriteObjTexCoords(std::ostream&, MapperT&&, const std::string&,
+template <typename WriterT, typename MapperT>
+std::uint64_t WriteObjTexCoords(WriterT* const, MapperT&&, const std::string&,
                                 NoOpFuncTag) {
   return 0;
 }
 
-template <typename MapperT>
-std::uint32_t WriteNormals(std::ostream& os, MapperT&& mapper,
+template <typename WriterT, typename MapperT>
+std::uint64_t WriteNormals(WriterT* const out, MapperT&& mapper,
                            const std::string& newline, FuncTag) {
-  return WriteMappedLines<IsNormal>(os, NormalPrefix(),
+  return WriteMappedLines<IsNormal>(out, NormalPrefix(),
                                     std::forward<MapperT>(mapper),
                                     [](const auto&) {},  // No validation.
                                     newline);
 }
 
 // Dummy.
-template <typename MapperT>
-std::uint32_t WriteNormals(std::ostream&, MapperT&&, const std::string&,
+template <typename WriterT, typename MapperT>
+std::uint64_t WriteNormals(WriterT* const, MapperT&&, const std::string&,
                            NoOpFuncTag) {
   return 0;
 }
 
-template <typename MapperT>
-std::uint32_t WriteFaces(std::ostream& os, MapperT&& mapper,
+template <typename WriterT, typename MapperT>
+std::uint64_t WriteFaces(WriterT* const out, MapperT&& mapper,
                          const std::string& newline) {
   return WriteMappedLines<IsFace>(
-      os, FacePrefix(), std::forward<MapperT>(mapper),
+      out, FacePrefix(), std::forward<MapperT>(mapper),
       [](const auto& face) {
         ValidateFace(face, typename FaceTraits<decltype(face)>::FaceCategory{});
       },
       newline);
 }
 
-}  // namespace write
-}  // namespace obj_io_internal
+template <typename SinkT, typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT, typename NormalMapperT,
+          typename ResultT>
+void WriteElements(SinkT* const sink, PositionMapperT&& position_mapper,
+                   FaceMapperT&& face_mapper,
+                   ObjTexCoordMapperT&& tex_coord_mapper,
+                   NormalMapperT&& normal_mapper, const std::string& newline,
+                   ResultT* const result) {
+  BlockWriter<SinkT> out(sink);
+  try {
+    WriteHeader(&out, newline);
+    result->position_count += WritePositions(
+        &out, std::forward<PositionMapperT>(position_mapper), newline);
+    result->tex_coord_count += WriteObjTexCoords(
+        &out, std::forward<ObjTexCoordMapperT>(tex_coord_mapper), newline,
+        typename FuncTraits<ObjTexCoordMapperT>::FuncCategory{});
+    result->normal_count += WriteNormals(
+        &out, std::forward<NormalMapperT>(normal_mapper), newline,
+        typename FuncTraits<NormalMapperT>::FuncCategory{});
+    result->face_count += WriteFaces(
+        &out, std::forward<FaceMapperT>(face_mapper), newline);
+  } catch (...) {
+    // Lines written before the error are still passed on.
+    out.Flush();
+    throw;
+  }
+  out.Flush();
+}
 
-struct ObjReadResult {
-  std::uint32_t position_count;
-  std::uint32_t face_count;
-  std::uint32_t tex_coord_count;
-  std::uint32_t normal_count;
-};
+// Formats into a growable string, for batches formatted on worker threads.
+class StringWriter {
+ public:
+  void Write(const char* const data, const std::size_t size) {
+    Commit(std::copy(data, data + size, Reserve(size)));
+  }
 
-template <typename AddPositionFuncT, typename AddFaceFuncT,
-          typename AddObjTexCoordFuncT = std::nullptr_t,
-          typename AddNormalFuncT = std::nullptr_t>
-ObjReadResult ReadObj(std::istream& is, 
-                      AddPositionFuncT&& add_position,
-                      AddFaceFuncT&& add_face,
-                      AddObjTexCoordFuncT&& add_tex_coord = nullptr,
-                      AddNormalFuncT&& add_normal = nullptr) {
-  ObjReadResult result = {};
-  obj_io_internal::read::ParseLines(
-      is, std::forward<AddPositionFuncT>(add_position),
-      std::forward<AddFaceFuncT>(add_face),
-      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-      std::forward<AddNormalFuncT>(add_normal), &result.position_count,
-      &result.face_count, &result.tex_coord_count, &result.normal_count);
-  return result;
-}
+  void Write(const std::string& str) { Write(str.data(), str.size()); }
 
-struct ObjWriteResult {
-  std::uint32_t position_count;
-  std::uint32_t face_count;
-  std::uint32_t tex_coord_count;
-  std::uint32_t normal_count;
+  char* Reserve(const std::size_t size) {
+    if (str_.size() - size_ < size) {
+      str_.resize(std::max(2 * str_.size(), size_ + size));
+    }
+    return &str_[size_];
+  }
+
+  void Commit(char* const end) noexcept {
+    size_ = static_cast<std::size_t>(end - &str_[0]);
+  }
+
+  const char* data() const noexcept { return str_.data(); }
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  std::string str_;
+  std::size_t size_ = 0;
 };
 
-template <typename PositionMapperT, typename FaceMapperT,
-          typename ObjTexCoordMapperT = std::nullptr_t,
-          typename NormalMapperT = std::nullptr_t>
-ObjWriteResult WriteObj(std::ostream& os, 
+// Formats batches of lines on worker threads. The calling thread passes
+// formatted batches on to the sink in submission order, so the output is
+// the same as when formatting serially. At most a few batches per thread
+// are kept in memory.
+template <typename SinkT>
+class ParallelLineWriter {
+ public:
+  using FormatFunc = std::function<void(StringWriter*)>;
+
+  ParallelLineWriter(SinkT* const sink, const std::uint32_t thread_count)
+      : sink_(sink), max_batch_count_(4 * std::size_t{thread_count}) {
+    try {
+      for (auto i = std::uint32_t{0}; i < thread_count; ++i) {
+        threads_.emplace_back([this]() { FormatBatches(); });
+      }
+    } catch (...) {
+      Stop();
+      throw;
+    }
+  }
+
+  ~ParallelLineWriter() { Stop(); }
+
+  ParallelLineWriter(const ParallelLineWriter&) = delete;
+  ParallelLineWriter& operator=(const ParallelLineWriter&) = delete;
+
+  void Submit(FormatFunc format) {
+    if (batches_.size() == max_batch_count_) {
+      WriteFirstBatch();
+    }
+    auto batch = std::unique_ptr<Batch>(new Batch);
+    batch->format = std::move(format);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(batch.get());
+      batches_.push_back(std::move(batch));
+    }
+    batch_added_.notify_one();
+  }
+
+  // Writes all batches. Rethrows the first error of any batch, after
+  // writing the lines formatted before it. Batches after the failed one
+  // are discarded.
+  void Finish() {
+    while (!batches_.empty()) {
+      WriteFirstBatch();
+    }
+  }
+
+ private:
+  struct Batch {
+    FormatFunc format;
+    StringWriter text;
+    std::exception_ptr error;
+    bool done = false;
+  };
+
+  void FormatBatches() {
+    while (true) {
+      auto batch = static_cast<Batch*>(nullptr);
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_added_.wait(lock,
+                          [this]() { return stop_ || !pending_.empty(); });
+        if (pending_.empty()) {
+          return;
+        }
+        batch = pending_.front();
+        pending_.pop_front();
+      }
+
+      try {
+        batch->format(&batch->text);
+      } catch (...) {
+        batch->error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch->done = true;
+      }
+      batch_done_.notify_all();
+    }
+  }
+
+  void WriteFirstBatch() {
+    auto batch = std::unique_ptr<Batch>{};
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      batch_done_.wait(lock, [this]() { return batches_.front()->done; });
+      batch = std::move(batches_.front());
+      batches_.pop_front();
+    }
+    if (batch->text.size() > 0) {
+      sink_->Write(batch->text.data(), batch->text.size());
+    }
+    if (batch->error) {
+      DiscardBatches();
+      std::rethrow_exception(batch->error);
+    }
+  }
+
+  // Drops the remaining batches without writing them. Batches that are
+  // being formatted are waited for, since workers refer to them.
+  void DiscardBatches() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto batch : pending_) {
+      batch->done = true;
+    }
+    pending_.clear();
+    batch_done_.wait(lock, [this]() {
+      return std::all_of(batches_.begin(), batches_.end(),
+                         [](const auto& batch) { return batch->done; });
+    });
+    batches_.clear();
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    batch_added_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  SinkT* sink_;
+  std::size_t max_batch_count_;
+  std::deque<std::unique_ptr<Batch>> batches_;
+  std::deque<Batch*> pending_;
+  std::mutex mutex_;
+  std::condition_variable batch_added_;
+  std::condition_variable batch_done_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Collects mapped elements in batches on the calling thread and submits
+// them for formatting. The write function formats the lines of a batch,
+// given a mapper over the batch elements.
+template <typename SinkT, typename MapperT, typename WriteFuncT>
+std::uint64_t WriteMappedLinesParallel(ParallelLineWriter<SinkT>* const out,
+                                       MapperT&& mapper,
+                                       WriteFuncT write_func) {
+  using ElementType = typename MapperTraits<MapperT>::MappedType;
+  constexpr auto kBatchSize = std::size_t{1} << 12;
+
+  const auto submit = [out, write_func](std::vector<ElementType> batch) {
+    out->Submit([batch = std::move(batch),
+                 write_func](StringWriter* const text) {
+      auto iter = batch.cbegin();
+      write_func(text, [&iter, &batch]() {
+        return iter == batch.cend() ? ObjEnd<ElementType>() : ObjMap(*iter++);
+      });
+    });
+  };
+
+  auto batch = std::vector<ElementType>{};
+  const auto count = ForEachMapped(
+      std::forward<MapperT>(mapper),
+      [&batch, &submit](const ElementType& value) {
+        batch.push_back(value);
+        if (batch.size() == kBatchSize) {
+          submit(std::move(batch));
+          batch = std::vector<ElementType>{};
+        }
+      },
+      typename MapperTraits<MapperT>::MapperCategory{});
+  if (!batch.empty()) {
+    submit(std::move(batch));
+  }
+  return count;
+}
+
+template <typename SinkT, typename MapperT>
+std::uint64_t WriteObjTexCoordsParallel(ParallelLineWriter<SinkT>* const out,
+                                        MapperT&& mapper,
+                                        const std::string& newline,
+                                        FuncTag) {
+  return WriteMappedLinesParallel(
+      out, std::forward<MapperT>(mapper),
+      [&newline](StringWriter* const text, auto&& batch_mapper) {
+        WriteObjTexCoords(text, batch_mapper, newline, FuncTag{});
+      });
+}
+
+// Dummy.
+template <typename SinkT, typename MapperT>
+std::uint64_t WriteObjTexCoordsParallel(ParallelLineWriter<SinkT>* const,
+                                        MapperT&&, const std::string&,
+                                        NoOpFuncTag) {
+  return 0;
+}
+
+template <typename SinkT, typename MapperT>
+std::uint64_t WriteNormalsParallel(ParallelLineWriter<SinkT>* const out,
+                                   MapperT&& mapper,
+                                   const std::string& newline, FuncTag) {
+  return WriteMappedLinesParallel(
+      out, std::forward<MapperT>(mapper),
+      [&newline](StringWriter* const text, auto&& batch_mapper) {
+        WriteNormals(text, batch_mapper, newline, FuncTag{});
+      });
+}
+
+// Dummy.
+template <typename SinkT, typename MapperT>
+std::uint64_t WriteNormalsParallel(ParallelLineWriter<SinkT>* const,
+                                   MapperT&&, const std::string&,
+                                   NoOpFuncTag) {
+  return 0;
+}
+
+template <typename SinkT, typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT, typename NormalMapperT,
+          typename ResultT>
+void WriteElementsParallel(SinkT* const sink,
+                           const std::uint32_t thread_count,
+                           PositionMapperT&& position_mapper,
+                           FaceMapperT&& face_mapper,
+                           ObjTexCoordMapperT&& tex_coord_mapper,
+                           NormalMapperT&& normal_mapper,
+                           const std::string& newline,
+                           ResultT* const result) {
+  if (thread_count < 2) {
+    WriteElements(sink, std::forward<PositionMapperT>(position_mapper),
+                  std::forward<FaceMapperT>(face_mapper),
+                  std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+                  std::forward<NormalMapperT>(normal_mapper), newline,
+                  result);
+    return;
+  }
+
+  {
+    BlockWriter<SinkT> header(sink);
+    WriteHeader(&header, newline);
+    header.Flush();
+  }
+
+  ParallelLineWriter<SinkT> out(sink, thread_count);
+  try {
+    result->position_count += WriteMappedLinesParallel(
+        &out, std::forward<PositionMapperT>(position_mapper),
+        [&newline](StringWriter* const text, auto&& batch_mapper) {
+          WritePositions(text, batch_mapper, newline);
+        });
+    result->tex_coord_count += WriteObjTexCoordsParallel(
+        &out, std::forward<ObjTexCoordMapperT>(tex_coord_mapper), newline,
+        typename FuncTraits<ObjTexCoordMapperT>::FuncCategory{});
+    result->normal_count += WriteNormalsParallel(
+        &out, std::forward<NormalMapperT>(normal_mapper), newline,
+        typename FuncTraits<NormalMapperT>::FuncCategory{});
+    result->face_count += WriteMappedLinesParallel(
+        &out, std::forward<FaceMapperT>(face_mapper),
+        [&newline](StringWriter* const text, auto&& batch_mapper) {
+          WriteFaces(text, batch_mapper, newline);
+        });
+  } catch (...) {
+    // Batches submitted before the error are still passed on, unless an
+    // earlier batch failed, in which case its error takes precedence.
+    out.Finish();
+    throw;
+  }
+  out.Finish();
+}
+
+}  // namespace write
+}  // namespace obj_io_internal
+
+struct ObjReadResult {
+  std::uint64_t position_count;
+  std::uint64_t face_count;
+  std::uint64_t tex_coord_count;
+  std::uint64_t normal_count;
+};
+
+// Same as ReadObj, but parse errors are reported through status instead
+// of being thrown. Parsing stops at the first error, elements parsed before
+// it have been passed to the add functions. Can be used when exceptions
+// are disabled.
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult TryReadObj(std::istream& is, 
+                         ObjReadStatus* const status,
+                         AddPositionFuncT&& add_position,
+                         AddFaceFuncT&& add_face,
+                         AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                         AddNormalFuncT&& add_normal = nullptr,
+                         AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  ObjReadResult result = {};
+  obj_io_internal::read::ParseLines<OptionsT>(
+      is, std::forward<AddPositionFuncT>(add_position),
+      std::forward<AddFaceFuncT>(add_face),
+      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+      std::forward<AddNormalFuncT>(add_normal),
+      std::forward<AddUnknownLineFuncT>(add_unknown_line),
+      &result.position_count, &result.face_count, &result.tex_coord_count,
+      &result.normal_count, status);
+  obj_io_internal::read::FlushAddFuncs(add_position, add_face, add_tex_coord,
+                                       add_normal, add_unknown_line);
+  return result;
+}
+
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult TryReadObj(const char* const data, 
+                         const std::size_t size,
+                         ObjReadStatus* const status,
+                         AddPositionFuncT&& add_position,
+                         AddFaceFuncT&& add_face,
+                         AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                         AddNormalFuncT&& add_normal = nullptr,
+                         AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  ObjReadResult result = {};
+  obj_io_internal::read::ParseLines<OptionsT>(
+      data, size, std::forward<AddPositionFuncT>(add_position),
+      std::forward<AddFaceFuncT>(add_face),
+      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+      std::forward<AddNormalFuncT>(add_normal),
+      std::forward<AddUnknownLineFuncT>(add_unknown_line),
+      &result.position_count, &result.face_count, &result.tex_coord_count,
+      &result.normal_count, status);
+  obj_io_internal::read::FlushAddFuncs(add_position, add_face, add_tex_coord,
+                                       add_normal, add_unknown_line);
+  return result;
+}
+
+#if defined(THINKS_OBJ_IO_EXCEPTIONS)
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult ReadObj(std::istream& is, 
+                      AddPositionFuncT&& add_position,
+                      AddFaceFuncT&& add_face,
+                      AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                      AddNormalFuncT&& add_normal = nullptr,
+                      AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  auto status = ObjReadStatus{};
+  auto result = ObjReadResult{};
+  try {
+    result = TryReadObj<OptionsT>(is, &status, add_position, add_face,
+                                  add_tex_coord, add_normal,
+                                  add_unknown_line);
+  } catch (...) {
+    // Elements parsed before the error are still passed on.
+    obj_io_internal::read::FlushAddFuncs(
+        add_position, add_face, add_tex_coord, add_normal, add_unknown_line);
+    throw;
+  }
+  obj_io_internal::read::ThrowIfError(status);
+  return result;
+}
+
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult ReadObj(const char* const data, 
+                      const std::size_t size,
+                      AddPositionFuncT&& add_position,
+                      AddFaceFuncT&& add_face,
+                      AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                      AddNormalFuncT&& add_normal = nullptr,
+                      AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  auto status = ObjReadStatus{};
+  auto result = ObjReadResult{};
+  try {
+    result = TryReadObj<OptionsT>(data, size, &status, add_position, add_face,
+                        add_tex_coord, add_normal, add_unknown_line);
+  } catch (...) {
+    // Elements parsed before the error are still passed on.
+    obj_io_internal::read::FlushAddFuncs(
+        add_position, add_face, add_tex_coord, add_normal, add_unknown_line);
+    throw;
+  }
+  obj_io_internal::read::ThrowIfError(status);
+  return result;
+}
+
+// Reads the buffer using multiple threads. Results and the order in which
+// add functions are called are the same as for ReadObj, and add functions
+// are only ever called from the calling thread. A thread count of zero
+// uses all hardware threads.
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult ReadObjParallel(const char* const data, 
+                              const std::size_t size,
+                              AddPositionFuncT&& add_position,
+                              AddFaceFuncT&& add_face,
+                              AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                              AddNormalFuncT&& add_normal = nullptr,
+                              std::uint32_t thread_count = 0,
+                              AddUnknownLineFuncT&& add_unknown_line =
+                                  nullptr) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  ObjReadResult result = {};
+  auto status = ObjReadStatus{};
+  try {
+    obj_io_internal::read::ParseLinesParallel<OptionsT>(
+        data, size, thread_count,
+        std::forward<AddPositionFuncT>(add_position),
+        std::forward<AddFaceFuncT>(add_face),
+        std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+        std::forward<AddNormalFuncT>(add_normal),
+        std::forward<AddUnknownLineFuncT>(add_unknown_line),
+        &result.position_count, &result.face_count, &result.tex_coord_count,
+        &result.normal_count, &status);
+  } catch (...) {
+    // Elements parsed before the error are still passed on.
+    obj_io_internal::read::FlushAddFuncs(
+        add_position, add_face, add_tex_coord, add_normal, add_unknown_line);
+    throw;
+  }
+  obj_io_internal::read::FlushAddFuncs(add_position, add_face, add_tex_coord,
+                                       add_normal, add_unknown_line);
+  obj_io_internal::read::ThrowIfError(status);
+  return result;
+}
+
+#if defined(__linux__)
+template <typename OptionsT = ObjReadOptions<>, typename AddPositionFuncT,
+          typename AddFaceFuncT, typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjReadResult ReadObjFile(const char* const path, 
+                          AddPositionFuncT&& add_position,
+                          AddFaceFuncT&& add_face,
+                          AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                          AddNormalFuncT&& add_normal = nullptr,
+                          AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  const obj_io_internal::read::MappedFile file(path);
+  return ReadObj<OptionsT>(file.data(), file.size(),
+                 std::forward<AddPositionFuncT>(add_position),
+                 std::forward<AddFaceFuncT>(add_face),
+                 std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+                 std::forward<AddNormalFuncT>(add_normal),
+                 std::forward<AddUnknownLineFuncT>(add_unknown_line));
+}
+#endif  // defined(__linux__)
+
+// Parses OBJ data that arrives in chunks of arbitrary size, e.g. from a pipe
+// or a decompressor. Lines are parsed as soon as they are complete, only a
+// partial line is kept between calls to Feed. Add functions are called in
+// the same way as by ReadObj. After an exception the parser must not be fed
+// any more data.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+class ObjStreamParser {
+ public:
+  ObjStreamParser(AddPositionFuncT add_position, AddFaceFuncT add_face,
+                  AddObjTexCoordFuncT add_tex_coord = nullptr,
+                  AddNormalFuncT add_normal = nullptr,
+                  AddUnknownLineFuncT add_unknown_line = nullptr)
+      : add_position_(std::move(add_position)),
+        add_face_(std::move(add_face)),
+        add_tex_coord_(std::move(add_tex_coord)),
+        add_normal_(std::move(add_normal)),
+        add_unknown_line_(std::move(add_unknown_line)),
+        result_{} {}
+
+  void Feed(const char* const data, const std::size_t size) {
+    const auto last = data + size;
+
+    // Find the end of the last complete line in this chunk.
+    auto lines_end = last;
+    while (lines_end != data && *(lines_end - 1) != '\n') {
+      --lines_end;
+    }
+    if (lines_end == data) {
+      partial_line_.append(data, size);
+      return;
+    }
+
+    auto lines_begin = data;
+    if (!partial_line_.empty()) {
+      // Complete the line started by previous chunks.
+      const auto newline = std::find(data, last, '\n');
+      partial_line_.append(data, newline);
+      Parse(partial_line_.data(), partial_line_.size());
+      lines_begin = newline + 1;
+    }
+    Parse(lines_begin, static_cast<std::size_t>(lines_end - lines_begin));
+    partial_line_.assign(lines_end, last);
+  }
+
+  // Parses the last line, which need not end with a newline.
+  ObjReadResult Finish() {
+    Parse(partial_line_.data(), partial_line_.size());
+    partial_line_.clear();
+    obj_io_internal::read::FlushAddFuncs(add_position_, add_face_,
+                                         add_tex_coord_, add_normal_,
+                                         add_unknown_line_);
+    return result_;
+  }
+
+  // Counts so far.
+  const ObjReadResult& result() const noexcept { return result_; }
+
+ private:
+  void Parse(const char* const data, const std::size_t size) {
+    auto status = ObjReadStatus{};
+    try {
+      obj_io_internal::read::ParseLines<ObjReadOptions<>>(
+          data, size, add_position_, add_face_, add_tex_coord_, add_normal_,
+          add_unknown_line_, &result_.position_count, &result_.face_count,
+          &result_.tex_coord_count, &result_.normal_count, &status);
+    } catch (...) {
+      // Elements parsed before the error are still passed on.
+      obj_io_internal::read::FlushAddFuncs(add_position_, add_face_,
+                                           add_tex_coord_, add_normal_,
+                                           add_unknown_line_);
+      throw;
+    }
+    if (!status.ok()) {
+      obj_io_internal::read::FlushAddFuncs(add_position_, add_face_,
+                                           add_tex_coord_, add_normal_,
+                                           add_unknown_line_);
+      obj_io_internal::read::ThrowIfError(status);
+    }
+  }
+
+  AddPositionFuncT add_position_;
+  AddFaceFuncT add_face_;
+  AddObjTexCoordFuncT add_tex_coord_;
+  AddNormalFuncT add_normal_;
+  AddUnknownLineFuncT add_unknown_line_;
+  ObjReadResult result_;
+  std::string partial_line_;
+};
+
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t,
+          typename AddUnknownLineFuncT = std::nullptr_t>
+ObjStreamParser<typename std::decay<AddPositionFuncT>::type,
+                typename std::decay<AddFaceFuncT>::type,
+                typename std::decay<AddObjTexCoordFuncT>::type,
+                typename std::decay<AddNormalFuncT>::type,
+                typename std::decay<AddUnknownLineFuncT>::type>
+MakeObjStreamParser(AddPositionFuncT&& add_position, AddFaceFuncT&& add_face,
+                    AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                    AddNormalFuncT&& add_normal = nullptr,
+                    AddUnknownLineFuncT&& add_unknown_line = nullptr) {
+  return {std::forward<AddPositionFuncT>(add_position),
+          std::forward<AddFaceFuncT>(add_face),
+          std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+          std::forward<AddNormalFuncT>(add_normal),
+          std::forward<AddUnknownLineFuncT>(add_unknown_line)};
+}
+
+#if defined(THINKS_OBJ_IO_COROUTINES)
+// Lazily produced sequence of values, iterated once with a range-based for
+// loop. Exceptions thrown while producing a value are rethrown when the
+// iterator is advanced.
+template <typename T>
+class ObjGenerator {
+ public:
+  struct promise_type {
+    ObjGenerator get_return_object() noexcept {
+      return ObjGenerator(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_always final_suspend() const noexcept { return {}; }
+
+    std::suspend_always yield_value(const T& yielded) noexcept {
+      value = std::addressof(yielded);
+      return {};
+    }
+
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    const T* value = nullptr;
+    std::exception_ptr error;
+  };
+
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+    using pointer = const T*;
+    using reference = const T&;
+
+    iterator() noexcept = default;
+    explicit iterator(const std::coroutine_handle<promise_type> handle) noexcept
+        : handle_(handle) {}
+
+    reference operator*() const noexcept { return *handle_.promise().value; }
+    pointer operator->() const noexcept { return handle_.promise().value; }
+
+    iterator& operator++() {
+      Resume(handle_);
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    friend bool operator==(const iterator& it,
+                           std::default_sentinel_t) noexcept {
+      return !it.handle_ || it.handle_.done();
+    }
+
+   private:
+    std::coroutine_handle<promise_type> handle_;
+  };
+
+  ObjGenerator(ObjGenerator&& other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  ObjGenerator& operator=(ObjGenerator&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~ObjGenerator() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  iterator begin() {
+    Resume(handle_);
+    return iterator(handle_);
+  }
+
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+ private:
+  explicit ObjGenerator(const std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  static void Resume(const std::coroutine_handle<promise_type> handle) {
+    handle.resume();
+    if (handle.promise().error) {
+      std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Pull-based alternative to ReadObj. Elements parses one line at a time as
+// the generator is advanced, yielding each element as one of the
+// alternatives of ElementType. The buffer must outlive the generator.
+template <typename PositionT, typename FaceT,
+          typename TexCoordT = ObjTexCoord<float, 2>,
+          typename NormalT = ObjNormal<float>>
+class ObjReader {
+ public:
+  using ElementType = std::variant<PositionT, FaceT, TexCoordT, NormalT>;
+
+  ObjReader(const char* const data, const std::size_t size) noexcept
+      : data_(data), size_(size) {}
+
+  ObjGenerator<ElementType> Elements() const {
+    return ReadElements(data_, size_);
+  }
+
+ private:
+  static ObjGenerator<ElementType> ReadElements(const char* const data,
+                                                const std::size_t size) {
+    // At most one element per line.
+    auto element = std::optional<ElementType>{};
+    const auto store = [&element](const auto& parsed) {
+      element.emplace(std::in_place_type<std::decay_t<decltype(parsed)>>,
+                      parsed);
+    };
+    auto add_position = MakeObjAddFunc<PositionT>(store);
+    auto add_face = MakeObjAddFunc<FaceT>(store);
+    auto add_tex_coord = MakeObjAddFunc<TexCoordT>(store);
+    auto add_normal = MakeObjAddFunc<NormalT>(store);
+
+    auto counts = std::array<std::uint64_t, 4>{};
+    auto status = ObjReadStatus{};
+    auto line_begin = static_cast<const char*>(nullptr);
+    auto line_end = static_cast<const char*>(nullptr);
+    auto line_scanner =
+        obj_io_internal::read::LineScanner(data, data + size);
+    obj_io_internal::read::LineStream line_stream;
+    while (line_scanner.Next(&line_begin, &line_end)) {
+      line_stream.Reset(line_begin, line_end);
+      if (!obj_io_internal::read::ParseLine<ObjReadOptions<>>(
+              &line_stream, add_position, add_face, add_tex_coord,
+              add_normal, nullptr, &counts[0], &counts[1], &counts[2],
+              &counts[3],
+              &status)) {
+        obj_io_internal::read::ThrowIfError(status);
+      }
+      if (element) {
+        co_yield *element;
+        element.reset();
+      }
+    }
+  }
+
+  const char* data_;
+  std::size_t size_;
+};
+#endif  // defined(THINKS_OBJ_IO_COROUTINES)
+#endif  // defined(THINKS_OBJ_IO_EXCEPTIONS)
+
+struct ObjCountResult {
+  std::uint64_t position_count;
+  std::uint64_t face_count;
+  std::uint64_t tex_coord_count;
+  std::uint64_t normal_count;
+
+  // Sum of index counts over all faces.
+  std::uint64_t face_index_count;
+};
+
+// Counts elements without parsing any values, e.g. to reserve storage
+// before calling ReadObj. Counts are exact for valid files.
+inline ObjCountResult CountObj(const char* const data, const std::size_t size) {
+  ObjCountResult result = {};
+  auto line_begin = static_cast<const char*>(nullptr);
+  auto line_end = static_cast<const char*>(nullptr);
+  auto line_scanner = obj_io_internal::read::LineScanner(data, data + size);
+  while (line_scanner.Next(&line_begin, &line_end)) {
+    obj_io_internal::read::CountLine(
+        line_begin, line_end, &result.position_count, &result.face_count,
+        &result.tex_coord_count, &result.normal_count,
+        &result.face_index_count);
+  }
+  return result;
+}
+
+inline ObjCountResult CountObj(std::istream& is) {
+  ObjCountResult result = {};
+  auto line = std::string{};
+  while (std::getline(is, line)) {
+    obj_io_internal::read::CountLine(
+        line.data(), line.data() + line.size(), &result.position_count,
+        &result.face_count, &result.tex_coord_count, &result.normal_count,
+        &result.face_index_count);
+  }
+  return result;
+}
+
+// Caller-provided arrays for ReadObjArrays. Positions and normals are stored
+// as xyz, texture coordinates as uv and triangles as three zero-based
+// position indices. Capacities count elements, not values, i.e. a position
+// capacity of 2 requires room for 6 floats.
+//
+// Faces may be polygons and may use index groups (e.g. "f 1/1/1 2/2/2
+// 3/3/3"). Polygons are fan triangulated, i.e. a face with n indices gives
+// n - 2 triangles, and only the position index of each index group is
+// stored. Texture coordinates may have a third value, which is dropped.
+struct ObjArrays {
+  float* positions = nullptr;
+  std::size_t position_capacity = 0;
+
+  std::uint32_t* triangle_indices = nullptr;
+  std::size_t triangle_capacity = 0;
+
+  float* tex_coords = nullptr;
+  std::size_t tex_coord_capacity = 0;
+
+  float* normals = nullptr;
+  std::size_t normal_capacity = 0;
+};
+
+namespace obj_io_internal {
+namespace read {
+
+template <typename ReadFuncT>
+ObjReadResult ReadArrays(const ObjArrays& arrays, ReadFuncT&& read) {
+  using TriangleType = ObjTriangleFace<ObjIndexGroup<std::uint32_t>>;
+  return read(
+      MakeObjAddFunc<ObjPosition<float, 3>>(ArrayWriter<float, 3>(
+          arrays.positions, arrays.position_capacity, "position")),
+      MakeObjAddTriangulateFunc<TriangleType>(
+          ArrayWriter<std::uint32_t, 3>(arrays.triangle_indices,
+                                        arrays.triangle_capacity, "triangle")),
+      MakeObjAddFunc<ObjTexCoord<float, 3>>(ArrayWriter<float, 2>(
+          arrays.tex_coords, arrays.tex_coord_capacity, "texture coordinate")),
+      MakeObjAddFunc<ObjNormal<float>>(ArrayWriter<float, 3>(
+          arrays.normals, arrays.normal_capacity, "normal")));
+}
+
+}  // namespace read
+}  // namespace obj_io_internal
+
+#if defined(THINKS_OBJ_IO_EXCEPTIONS)
+// Reads a triangle mesh straight into flat arrays, without add functions.
+// Elements are counted but not stored when their array is null, so array
+// sizes can be found by a first call with null arrays (or by CountObj,
+// where the triangle count is face_index_count - 2 * face_count) before a
+// second call fills the arrays. The face count of the result is the number
+// of triangles. Throws if an array is too small.
+inline ObjReadResult ReadObjArrays(const char* const data,
+                                   const std::size_t size,
+                                   const ObjArrays& arrays) {
+  return obj_io_internal::read::ReadArrays(
+      arrays, [data, size](auto&& add_position, auto&& add_face,
+                           auto&& add_tex_coord, auto&& add_normal) {
+        return ReadObj(data, size, add_position, add_face, add_tex_coord,
+                       add_normal);
+      });
+}
+
+inline ObjReadResult ReadObjArrays(std::istream& is, const ObjArrays& arrays) {
+  return obj_io_internal::read::ReadArrays(
+      arrays, [&is](auto&& add_position, auto&& add_face, auto&& add_tex_coord,
+                    auto&& add_normal) {
+        return ReadObj(is, add_position, add_face, add_tex_coord, add_normal);
+      });
+}
+
+// Vertex and index buffers returned by ReadObjUnified. Each vertex is a
+// unique (position, texture coordinate, normal) index group of the file.
+// Positions and normals are stored as xyz, texture coordinates as uv and
+// triangles as three zero-based vertex indices. Texture coordinates and
+// normals are empty if no index group refers to them, otherwise missing
+// values are zero.
+template <typename IndexIntT>
+struct ObjUnifiedMesh {
+  std::vector<float> positions;
+  std::vector<float> tex_coords;
+  std::vector<float> normals;
+  std::vector<IndexIntT> indices;
+};
+
+namespace obj_io_internal {
+namespace read {
+
+// Open addressing hash table (linear probing) mapping index groups to
+// vertex indices. Slots are 16 bytes, so probes stay within few cache lines.
+class IndexGroupTable {
+ public:
+  static constexpr std::uint32_t kNoIndex =
+      std::numeric_limits<std::uint32_t>::max();
+
+  struct Slot {
+    std::uint32_t position;
+    std::uint32_t tex_coord;
+    std::uint32_t normal;
+    std::uint32_t vertex;
+  };
+
+  IndexGroupTable() : slots_(kInitialCapacity, EmptySlot()), size_(0) {}
+
+  // Returns the vertex index of the index group, a new vertex index is
+  // assigned to index groups not seen before.
+  std::uint32_t Insert(const std::uint32_t position,
+                       const std::uint32_t tex_coord,
+                       const std::uint32_t normal) {
+    // Keep load factor at most 1/2. Computed in std::size_t, since twice
+    // the 32-bit size may not fit in 32 bits.
+    if (2 * (std::size_t{size_} + 1) > slots_.size()) {
+      Grow();
+    }
+
+    auto slot = Probe(position, tex_coord, normal);
+    if (slot->vertex == kNoIndex) {
+      if (size_ == kNoIndex) {
+        // kNoIndex marks empty slots and cannot be a vertex index.
+        throw std::runtime_error("too many unique index groups");
+      }
+      *slot = {position, tex_coord, normal, size_++};
+    }
+    return slot->vertex;
+  }
+
+  std::uint32_t size() const noexcept { return size_; }
+  const std::vector<Slot>& slots() const noexcept { return slots_; }
+
+ private:
+  static constexpr std::size_t kInitialCapacity = 1024;
+
+  static Slot EmptySlot() noexcept {
+    return {kNoIndex, kNoIndex, kNoIndex, kNoIndex};
+  }
+
+  static std::uint64_t Hash(const std::uint32_t position,
+                            const std::uint32_t tex_coord,
+                            const std::uint32_t normal) noexcept {
+    auto h = position * std::uint64_t{0x9E3779B97F4A7C15};
+    h ^= tex_coord * std::uint64_t{0xC2B2AE3D27D4EB4F};
+    h ^= normal * std::uint64_t{0x165667B19E3779F9};
+    return h ^ (h >> 32);
+  }
+
+  // Returns the slot holding the index group, or the empty slot where
+  // it should be inserted.
+  Slot* Probe(const std::uint32_t position, const std::uint32_t tex_coord,
+              const std::uint32_t normal) noexcept {
+    const auto mask = slots_.size() - 1;
+    auto i = static_cast<std::size_t>(Hash(position, tex_coord, normal)) &
+             mask;
+    while (true) {
+      auto& slot = slots_[i];
+      if (slot.vertex == kNoIndex ||
+          (slot.position == position && slot.tex_coord == tex_coord &&
+           slot.normal == normal)) {
+        return &slot;
+      }
+      i = (i + 1) & mask;
+    }
+  }
+
+  void Grow() {
+    auto old_slots = std::vector<Slot>(2 * slots_.size(), EmptySlot());
+    old_slots.swap(slots_);
+    for (const auto& slot : old_slots) {
+      if (slot.vertex != kNoIndex) {
+        *Probe(slot.position, slot.tex_coord, slot.normal) = slot;
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::uint32_t size_;
+};
+
+// Assigns vertex indices to the index groups of triangles as they are
+// read. Attribute values are gathered per vertex once all elements have
+// been read, since faces may refer to attributes in any order.
+template <typename IndexIntT>
+class IndexGroupUnifier {
+ public:
+  using FaceType = ObjTriangleFace<ObjIndexGroup<std::uint32_t>>;
+
+  void AddFace(const FaceType& face) {
+    for (const auto& index_group : face.values) {
+      const auto vertex = table_.Insert(
+          index_group.position_index.value,
+          IndexValue(index_group.tex_coord_index),
+          IndexValue(index_group.normal_index));
+      if (vertex > std::numeric_limits<IndexIntT>::max()) {
+        auto oss = std::ostringstream{};
+        oss << "unified vertex count exceeds index type range (max "
+            << std::numeric_limits<IndexIntT>::max() << ")";
+        throw std::runtime_error(oss.str());
+      }
+      mesh_.indices.push_back(static_cast<IndexIntT>(vertex));
+    }
+  }
+
+  // Releases the attribute values as soon as they have been gathered.
+  ObjUnifiedMesh<IndexIntT> Finish(std::vector<float>* const positions,
+                                   std::vector<float>* const tex_coords,
+                                   std::vector<float>* const normals) {
+    Gather<3>(positions, &IndexGroupTable::Slot::position, "position",
+              &mesh_.positions);
+    Gather<2>(tex_coords, &IndexGroupTable::Slot::tex_coord,
+              "texture coordinate", &mesh_.tex_coords);
+    Gather<3>(normals, &IndexGroupTable::Slot::normal, "normal",
+              &mesh_.normals);
+    return std::move(mesh_);
+  }
+
+ private:
+  template <typename IntT>
+  static std::uint32_t IndexValue(
+      const std::pair<ObjIndex<IntT>, bool>& index) noexcept {
+    return index.second ? index.first.value : IndexGroupTable::kNoIndex;
+  }
+
+  template <std::size_t N>
+  void Gather(std::vector<float>* const values,
+              std::uint32_t IndexGroupTable::Slot::*const index,
+              const char* const name, std::vector<float>* const out) const {
+    const auto& slots = table_.slots();
+    const auto used = std::any_of(
+        slots.begin(), slots.end(), [index](const auto& slot) {
+          return slot.vertex != IndexGroupTable::kNoIndex &&
+                 slot.*index != IndexGroupTable::kNoIndex;
+        });
+    if (used) {
+      const auto count = values->size() / N;
+      out->assign(N * table_.size(), 0.f);
+      for (const auto& slot : slots) {
+        if (slot.vertex == IndexGroupTable::kNoIndex ||
+            slot.*index == IndexGroupTable::kNoIndex) {
+          continue;
+        }
+        if (slot.*index >= count) {
+          auto oss = std::ostringstream{};
+          oss << name << " index " << slot.*index + 1
+              << " out of range (count " << count << ")";
+          throw std::runtime_error(oss.str());
+        }
+        std::copy_n(values->data() + N * slot.*index, N,
+                    out->data() + N * slot.vertex);
+      }
+    }
+    std::vector<float>().swap(*values);
+  }
+
+  IndexGroupTable table_;
+  ObjUnifiedMesh<IndexIntT> mesh_;
+};
+
+template <typename T>
+class ValueAppender {
+ public:
+  explicit ValueAppender(std::vector<T>* const values) noexcept
+      : values_(values) {}
+
+  template <typename ElementT>
+  void operator()(const ElementT& element) const {
+    values_->insert(values_->end(), element.values.begin(),
+                    element.values.end());
+  }
+
+ private:
+  std::vector<T>* values_;
+};
+
+template <typename IndexIntT, typename ReadFuncT>
+ObjUnifiedMesh<IndexIntT> ReadUnified(ReadFuncT&& read) {
+  static_assert(std::is_same<IndexIntT, std::uint16_t>::value ||
+                    std::is_same<IndexIntT, std::uint32_t>::value,
+                "index type must be std::uint16_t or std::uint32_t");
+  using UnifierType = IndexGroupUnifier<IndexIntT>;
+
+  auto positions = std::vector<float>{};
+  auto tex_coords = std::vector<float>{};
+  auto normals = std::vector<float>{};
+  UnifierType unifier;
+  read(MakeObjAddFunc<ObjPosition<float, 3>>(
+           ValueAppender<float>(&positions)),
+       MakeObjAddTriangulateFunc<typename UnifierType::FaceType>(
+           [&unifier](const auto& face) { unifier.AddFace(face); }),
+       MakeObjAddFunc<ObjTexCoord<float, 2>>(
+           ValueAppender<float>(&tex_coords)),
+       MakeObjAddFunc<ObjNormal<float>>(ValueAppender<float>(&normals)));
+  return unifier.Finish(&positions, &tex_coords, &normals);
+}
+
+}  // namespace read
+}  // namespace obj_io_internal
+
+// Reads a mesh into a single indexed vertex buffer, e.g. for rendering.
+// Index groups are deduplicated while faces are read, faces with more than
+// three indices are fan triangulated. IndexIntT is std::uint16_t or
+// std::uint32_t, throws if there are more unique index groups than the
+// index type can address.
+template <typename IndexIntT = std::uint32_t>
+ObjUnifiedMesh<IndexIntT> ReadObjUnified(const char* const data,
+                                         const std::size_t size) {
+  return obj_io_internal::read::ReadUnified<IndexIntT>(
+      [data, size](auto&& add_position, auto&& add_face,
+                   auto&& add_tex_coord, auto&& add_normal) {
+        ReadObj(data, size, add_position, add_face, add_tex_coord,
+                add_normal);
+      });
+}
+
+template <typename IndexIntT = std::uint32_t>
+ObjUnifiedMesh<IndexIntT> ReadObjUnified(std::istream& is) {
+  return obj_io_internal::read::ReadUnified<IndexIntT>(
+      [&is](auto&& add_position, auto&& add_face, auto&& add_tex_coord,
+            auto&& add_normal) {
+        ReadObj(is, add_position, add_face, add_tex_coord, add_normal);
+      });
+}
+#endif  // defined(THINKS_OBJ_IO_EXCEPTIONS)
+
+struct ObjWriteResult {
+  std::uint64_t position_count;
+  std::uint64_t face_count;
+  std::uint64_t tex_coord_count;
+  std::uint64_t normal_count;
+};
+
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObj(std::ostream& os, 
+                        PositionMapperT&& position_mapper,
+                        FaceMapperT&& face_mapper,
+                        ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                        NormalMapperT&& normal_mapper = nullptr,
+                        const std::string& newline = "\n") {
+  ObjWriteResult result = {};
+  auto sink = obj_io_internal::write::OStreamSink(&os);
+  obj_io_internal::write::WriteElements(
+      &sink, std::forward<PositionMapperT>(position_mapper),
+      std::forward<FaceMapperT>(face_mapper),
+      std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+      std::forward<NormalMapperT>(normal_mapper), newline, &result);
+  return result;
+}
+
+// Same as WriteObj, but characters are passed on by calling
+// sink->Write(const char* data, std::size_t size) in large blocks, e.g. to
+// write straight to a file descriptor or a memory-mapped region.
+template <typename SinkT, typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObj(SinkT* const sink, 
+                        PositionMapperT&& position_mapper,
+                        FaceMapperT&& face_mapper,
+                        ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                        NormalMapperT&& normal_mapper = nullptr,
+                        const std::string& newline = "\n") {
+  ObjWriteResult result = {};
+  obj_io_internal::write::WriteElements(
+      sink, std::forward<PositionMapperT>(position_mapper),
+      std::forward<FaceMapperT>(face_mapper),
+      std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+      std::forward<NormalMapperT>(normal_mapper), newline, &result);
+  return result;
+}
+
+// Same as WriteObj, but lines are formatted on multiple threads. Mappers
+// are only ever called from the calling thread, in the same order as by
+// WriteObj, and the output is identical. A thread count of zero uses all
+// hardware threads.
+template <typename SinkT, typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObjParallel(SinkT* const sink,
+                                PositionMapperT&& position_mapper,
+                                FaceMapperT&& face_mapper,
+                                ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                                NormalMapperT&& normal_mapper = nullptr,
+                                std::uint32_t thread_count = 0,
+                                const std::string& newline = "\n") {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  ObjWriteResult result = {};
+  obj_io_internal::write::WriteElementsParallel(
+      sink, thread_count, std::forward<PositionMapperT>(position_mapper),
+      std::forward<FaceMapperT>(face_mapper),
+      std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+      std::forward<NormalMapperT>(normal_mapper), newline, &result);
+  return result;
+}
+
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObjParallel(std::ostream& os,
+                                PositionMapperT&& position_mapper,
+                                FaceMapperT&& face_mapper,
+                                ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                                NormalMapperT&& normal_mapper = nullptr,
+                                const std::uint32_t thread_count = 0,
+                                const std::string& newline = "\n") {
+  auto sink = obj_io_internal::write::OStreamSink(&os);
+  return WriteObjParallel(&sink,
+                          std::forward<PositionMapperT>(position_mapper),
+                          std::forward<FaceMapperT>(face_mapper),
+                          std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+                          std::forward<NormalMapperT>(normal_mapper),
+                          thread_count, newline);
+}
+
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObjParallel(std::string* const str,
+                                PositionMapperT&& position_mapper,
+                                FaceMapperT&& face_mapper,
+                                ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                                NormalMapperT&& normal_mapper = nullptr,
+                                const std::uint32_t thread_count = 0,
+                                const std::string& newline = "\n") {
+  auto sink = obj_io_internal::write::StringSink(str);
+  return WriteObjParallel(&sink,
+                          std::forward<PositionMapperT>(position_mapper),
+                          std::forward<FaceMapperT>(face_mapper),
+                          std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+                          std::forward<NormalMapperT>(normal_mapper),
+                          thread_count, newline);
+}
+
+// Same as WriteObj, but appends to a string without going through
+// std::ostream.
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObj(std::string* const str, 
                         PositionMapperT&& position_mapper,
                         FaceMapperT&& face_mapper,
                         ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
                         NormalMapperT&& normal_mapper = nullptr,
                         const std::string& newline = "\n") {
+  auto sink = obj_io_internal::write::StringSink(str);
+  return WriteObj(&sink, std::forward<PositionMapperT>(position_mapper),
+                  std::forward<FaceMapperT>(face_mapper),
+                  std::forward<ObjTexCoordMapperT>(tex_coord_mapper),
+                  std::forward<NormalMapperT>(normal_mapper), newline);
+}
+
+// Caller-provided arrays for WriteObjArrays. Positions and normals are
+// stored as xyz and texture coordinates as uv, counts are elements, not
+// values. Attributes with null arrays are not written.
+//
+// Faces are triangles, i.e. three position indices per face, when
+// face_offsets is null. Otherwise faces are polygons stored in CSR form:
+// face i has the indices [face_offsets[i], face_offsets[i + 1]), so
+// face_offsets has face_count + 1 entries. Faces are written as index
+// groups when texture coordinate and/or normal indices are given; these
+// arrays run parallel to the position indices. All indices are zero-based.
+struct ObjWriteArrays {
+  const float* positions = nullptr;
+  std::size_t position_count = 0;
+
+  const float* tex_coords = nullptr;
+  std::size_t tex_coord_count = 0;
+
+  const float* normals = nullptr;
+  std::size_t normal_count = 0;
+
+  const std::uint32_t* face_offsets = nullptr;
+  std::size_t face_count = 0;
+
+  const std::uint32_t* position_indices = nullptr;
+  const std::uint32_t* tex_coord_indices = nullptr;
+  const std::uint32_t* normal_indices = nullptr;
+};
+
+namespace obj_io_internal {
+namespace write {
+
+// Writes a line per count elements of N values, with one reservation per
+// line.
+template <std::size_t N, typename WriterT, typename ValidatorT>
+std::uint64_t WriteArrayLines(WriterT* const out, const char* const line_prefix,
+                              const float* const values,
+                              const std::size_t count, ValidatorT validator,
+                              const std::string& newline) {
+  if (values == nullptr) {
+    return 0;
+  }
+
+  const auto prefix_size = std::strlen(line_prefix);
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    const auto element = values + N * i;
+    validator(element);
+
+    auto pos = out->Reserve(prefix_size + N * (1 + kMaxFloatChars));
+    pos = std::copy(line_prefix, line_prefix + prefix_size, pos);
+    for (auto j = std::size_t{0}; j < N; ++j) {
+      *pos++ = ' ';
+      pos = FormatFloat(pos, element[j]);
+    }
+    out->Commit(pos);
+    out->Write(newline);
+  }
+  return count;
+}
+
+template <IndexGroupLayout LayoutT, typename WriterT>
+std::uint64_t WriteArrayFaces(WriterT* const out, const ObjWriteArrays& arrays,
+                              const std::string& newline) {
+  constexpr auto kIndicesPerTriangle = std::size_t{3};
+  const auto tex_coord_indices = arrays.tex_coord_indices;
+  const auto normal_indices = arrays.normal_indices;
+
+  for (auto i = std::size_t{0}; i < arrays.face_count; ++i) {
+    const auto begin = arrays.face_offsets == nullptr
+                           ? kIndicesPerTriangle * i
+                           : std::size_t{arrays.face_offsets[i]};
+    const auto end = arrays.face_offsets == nullptr
+                         ? begin + kIndicesPerTriangle
+                         : std::size_t{arrays.face_offsets[i + 1]};
+    if (end < begin) {
+      auto oss = std::ostringstream{};
+      oss << "face offsets must be non-decreasing (found " << end
+          << " after " << begin << ")";
+      throw std::runtime_error(oss.str());
+    }
+    if (end - begin < kIndicesPerTriangle) {
+      auto oss = std::ostringstream{};
+      oss << "faces must have at least 3 indices (found " << end - begin
+          << ")";
+      throw std::runtime_error(oss.str());
+    }
+
+    out->Write(FacePrefix(), std::strlen(FacePrefix()));
+    for (auto j = begin; j < end; ++j) {
+      // Layout determines which of the index arrays are read.
+      const auto index_group = ObjIndexGroup<std::uint32_t>(
+          arrays.position_indices[j],
+          std::make_pair(tex_coord_indices ? tex_coord_indices[j] : 0u,
+                         tex_coord_indices != nullptr),
+          std::make_pair(normal_indices ? normal_indices[j] : 0u,
+                         normal_indices != nullptr));
+      auto pos = out->Reserve(kMaxIndexGroupChars);
+      *pos++ = ' ';
+      out->Commit(FormatIndexGroup<LayoutT>(pos, index_group));
+    }
+    out->Write(newline);
+  }
+  return arrays.face_count;
+}
+
+template <typename SinkT>
+void WriteArrays(SinkT* const sink, const ObjWriteArrays& arrays,
+                 const std::string& newline, ObjWriteResult* const result) {
+  BlockWriter<SinkT> out(sink);
+  try {
+    WriteHeader(&out, newline);
+    result->position_count += WriteArrayLines<3>(
+        &out, PositionPrefix(), arrays.positions, arrays.position_count,
+        [](const float*) {},  // No validation.
+        newline);
+    result->tex_coord_count += WriteArrayLines<2>(
+        &out, ObjTexCoordPrefix(), arrays.tex_coords, arrays.tex_coord_count,
+        [](const float* const tex_coord) {
+          ValidateObjTexCoord(
+              ObjTexCoord<float, 2>(tex_coord[0], tex_coord[1]));
+        },
+        newline);
+    result->normal_count += WriteArrayLines<3>(
+        &out, NormalPrefix(), arrays.normals, arrays.normal_count,
+        [](const float*) {},  // No validation.
+        newline);
+
+    if (arrays.position_indices != nullptr) {
+      switch (static_cast<IndexGroupLayout>(
+          (arrays.tex_coord_indices != nullptr ? 1 : 0) |
+          (arrays.normal_indices != nullptr ? 2 : 0))) {
+        case IndexGroupLayout::kPosition:
+          result->face_count +=
+              WriteArrayFaces<IndexGroupLayout::kPosition>(&out, arrays,
+                                                          newline);
+          break;
+        case IndexGroupLayout::kTexCoord:
+          result->face_count +=
+              WriteArrayFaces<IndexGroupLayout::kTexCoord>(&out, arrays,
+                                                          newline);
+          break;
+        case IndexGroupLayout::kNormal:
+          result->face_count += WriteArrayFaces<IndexGroupLayout::kNormal>(
+              &out, arrays, newline);
+          break;
+        case IndexGroupLayout::kTexCoordNormal:
+          result->face_count +=
+              WriteArrayFaces<IndexGroupLayout::kTexCoordNormal>(&out, arrays,
+                                                                newline);
+          break;
+      }
+    }
+  } catch (...) {
+    // Lines written before the error are still passed on.
+    out.Flush();
+    throw;
+  }
+  out.Flush();
+}
+
+}  // namespace write
+}  // namespace obj_io_internal
+
+#if defined(THINKS_OBJ_IO_EXCEPTIONS)
+// Writes a mesh straight from flat arrays, without mappers. The output is
+// the same as WriteObj with the corresponding mappers.
+template <typename SinkT>
+ObjWriteResult WriteObjArrays(SinkT* const sink, const ObjWriteArrays& arrays,
+                              const std::string& newline = "\n") {
   ObjWriteResult result = {};
-  obj_io_internal::write::WriteHeader(os, newline);
-  result.position_count += obj_io_internal::write::WritePositions(
-      os, std::forward<PositionMapperT>(position_mapper), newline);
-  result.tex_coord_count += obj_io_internal::write::WriteObjTexCoords(
-      os, std::forward<ObjTexCoordMapperT>(tex_coord_mapper), newline,
-      typename obj_io_internal::FuncTraits<ObjTexCoordMapperT>::FuncCategory{});
-  result.normal_count += obj_io_internal::write::WriteNormals(
-      os, std::forward<NormalMapperT>(normal_mapper), newline,
-      typename obj_io_internal::FuncTraits<NormalMapperT>::FuncCategory{});
-  result.face_count += obj_io_internal::write::WriteFaces(
-      os, std::forward<FaceMapperT>(face_mapper), newline);
+  obj_io_internal::write::WriteArrays(sink, arrays, newline, &result);
   return result;
 }
 
+inline ObjWriteResult WriteObjArrays(std::ostream& os,
+                                     const ObjWriteArrays& arrays,
+                                     const std::string& newline = "\n") {
+  auto sink = obj_io_internal::write::OStreamSink(&os);
+  return WriteObjArrays(&sink, arrays, newline);
+}
+
+inline ObjWriteResult WriteObjArrays(std::string* const str,
+                                     const ObjWriteArrays& arrays,
+                                     const std::string& newline = "\n") {
+  auto sink = obj_io_internal::write::StringSink(str);
+  return WriteObjArrays(&sink, arrays, newline);
+}
+#endif  // defined(THINKS_OBJ_IO_EXCEPTIONS)
+
 }  // namespace thinks
@@ -2,14 +2,36 @@
 // This file is subject to the license terms in the LICENSE file
 // found in the top-level directory of this distribution.
 
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#endif
 
 #include "catch2/catch.hpp"
 #include "catch_mesh_matcher.h"
 #include "mesh_types.h"
 #include "read_write_utils.h"
 
+// The C++20 test target must not silently skip the coroutine tests.
+#if defined(THINKS_OBJ_IO_TEST_COROUTINES) && \
+    !defined(THINKS_OBJ_IO_COROUTINES)
+#error "coroutine tests requested, but ObjReader is not available"
+#endif
+
 namespace {
 
 TEST_CASE("READ", "[container]") {
@@ -308,6 +330,1061 @@ TEST_CASE("READ - index group", "[container]") {
   }
 }
 
+TEST_CASE("READ - small polygon faces", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType =
+      thinks::ObjSmallPolygonFace<thinks::ObjIndexGroup<std::uint32_t>, 4>;
+
+  const auto input = std::string(
+      "v 0 1 2\n"
+      "f 1 2 3\n"
+      "f 1/1 2/2 3/3 4/4\n"
+      "f 1//1 2//2 3//3 4//4 5//5 6//6 7//7 8//8 9//9 10//10\n");
+
+  auto faces = std::vector<std::vector<std::uint32_t>>{};
+  auto add_position = MakeObjAddFunc<ObjPositionType>([](const auto&) {});
+  auto add_face = MakeObjAddFunc<ObjFaceType>([&faces](const auto& face) {
+    auto indices = std::vector<std::uint32_t>{};
+    for (const auto& index_group : face.values) {
+      indices.push_back(index_group.position_index.value);
+    }
+    faces.push_back(indices);
+  });
+
+  SECTION("values") {
+    const auto result =
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face);
+
+    REQUIRE(result.face_count == 3);
+    REQUIRE(faces[0] == std::vector<std::uint32_t>{0, 1, 2});
+    REQUIRE(faces[1] == std::vector<std::uint32_t>{0, 1, 2, 3});
+    REQUIRE(faces[2] ==
+            std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  }
+
+  SECTION("index count") {
+    const auto bad_input = std::string("f 1 2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(bad_input.data(), bad_input.size(), add_position,
+                        add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "faces must have at least 3 indices (found 2)"});
+  }
+}
+
+TEST_CASE("READ - triangulate", "[container]") {
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+  using TriangleType = std::array<std::uint32_t, 3>;
+
+  // Concave quad, a fan from the first index covers the fourth position.
+  const auto input = std::string(
+      "v 4 0 0\n"
+      "v 2 3 0\n"
+      "v 0 0 0\n"
+      "v 2 1 0\n"
+      "f 1 2 3 4\n"
+      "f 1 2 3\n");
+
+  auto positions = std::vector<ObjPositionType>{};
+  auto triangles = std::vector<TriangleType>{};
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&positions](const auto& pos) { positions.push_back(pos); });
+  auto add_triangle = [&triangles](const auto& face) {
+    triangles.push_back(TriangleType{{face.values[0].value,
+                                      face.values[1].value,
+                                      face.values[2].value}});
+  };
+  auto lookup_position = [&positions](const std::uint32_t index) {
+    return positions[index];
+  };
+
+  // Twice the signed area in the xy-plane.
+  const auto area = [&positions](const TriangleType& t) {
+    const auto& a = positions[t[0]].values;
+    const auto& b = positions[t[1]].values;
+    const auto& c = positions[t[2]].values;
+    return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+  };
+
+  SECTION("fan") {
+    const auto result = thinks::ReadObj(
+        input.data(), input.size(), add_position,
+        thinks::MakeObjAddTriangulateFunc<ObjFaceType>(add_triangle));
+
+    REQUIRE(result.face_count == 3);
+    REQUIRE(triangles == std::vector<TriangleType>{
+                             {{0, 1, 2}}, {{0, 2, 3}}, {{0, 1, 2}}});
+  }
+
+  SECTION("ear clip") {
+    const auto result = thinks::ReadObj(
+        input.data(), input.size(), add_position,
+        thinks::MakeObjAddEarClipFunc<ObjFaceType>(add_triangle,
+                                                   lookup_position));
+
+    REQUIRE(result.face_count == 3);
+    REQUIRE(area(triangles[0]) > 0.f);
+    REQUIRE(area(triangles[1]) > 0.f);
+    REQUIRE(area(triangles[0]) + area(triangles[1]) == 8.f);
+    REQUIRE(triangles[2] == TriangleType{{0, 1, 2}});
+  }
+
+  SECTION("ear clip parallel") {
+    // Large enough to be split into several chunks.
+    auto large_input = std::string{};
+    for (auto i = 0; i < 5000; ++i) {
+      large_input += input;
+    }
+
+    thinks::ReadObj(large_input.data(), large_input.size(), add_position,
+                    thinks::MakeObjAddEarClipFunc<ObjFaceType>(
+                        add_triangle, lookup_position));
+    const auto serial_triangles = triangles;
+    positions.clear();
+    triangles.clear();
+    const auto result = thinks::ReadObjParallel(
+        large_input.data(), large_input.size(), add_position,
+        thinks::MakeObjAddEarClipFunc<ObjFaceType>(add_triangle,
+                                                   lookup_position),
+        nullptr, nullptr, /* thread_count */ 4);
+
+    REQUIRE(result.face_count == 3 * 5000);
+    REQUIRE(triangles == serial_triangles);
+  }
+
+  SECTION("index count") {
+    const auto bad_input = std::string("f 1 2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(
+            bad_input.data(), bad_input.size(), add_position,
+            thinks::MakeObjAddTriangulateFunc<ObjFaceType>(add_triangle)),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "faces must have at least 3 indices (found 2)"});
+  }
+}
+
+TEST_CASE("READ - buffer", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+  auto positions = std::vector<ObjPositionType>{};
+  auto add_position = MakeObjAddFunc<ObjPositionType>(
+      [&positions](const auto& pos) { positions.push_back(pos); });
+
+  auto indices = std::vector<std::uint32_t>{};
+  auto add_face = MakeObjAddFunc<ObjFaceType>([&indices](const auto& face) {
+    for (const auto idx : face.values) {
+      indices.push_back(idx.value);
+    }
+  });
+
+  SECTION("lines") {
+    const auto input = std::string(
+        "# comment\n"
+        "\n"
+        "v 1 2 3\r\n"
+        "v 4 5 6\n"
+        "v 7 8 9\n"
+        "f 1 2 3\n"
+        "f 3 2 1");  // No trailing newline.
+
+    const auto result =
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face);
+
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 2);
+    REQUIRE(positions.size() == 3);
+    REQUIRE(positions[1].values == (std::array<float, 3>{4.f, 5.f, 6.f}));
+    REQUIRE(indices == (std::vector<std::uint32_t>{0, 1, 2, 2, 1, 0}));
+  }
+
+  SECTION("long lines") {
+    // Lines of varying length that straddle the scanner's block boundaries,
+    // with and without a trailing newline.
+    auto input = std::string{};
+    for (auto i = 0; i < 100; ++i) {
+      input += "v " + std::to_string(i) + std::string(i % 70, ' ') + " 0 0";
+      input += i % 3 == 0 ? "\r\n" : "\n";
+      input += std::string(i % 5, '\n');
+    }
+    input += "f 1 2 3";
+
+    for (const auto trailing_newline : {false, true}) {
+      positions.clear();
+      indices.clear();
+      const auto buffer = trailing_newline ? input + "\n" : input;
+      const auto result =
+          thinks::ReadObj(buffer.data(), buffer.size(), add_position, add_face);
+
+      REQUIRE(result.position_count == 100);
+      REQUIRE(result.face_count == 1);
+      for (std::size_t i = 0; i < positions.size(); ++i) {
+        REQUIRE(positions[i].values[0] == static_cast<float>(i));
+      }
+    }
+  }
+
+  SECTION("empty") {
+    const auto result =
+        thinks::ReadObj("", std::size_t{0}, add_position, add_face);
+
+    REQUIRE(result.position_count == 0);
+    REQUIRE(result.face_count == 0);
+  }
+
+  SECTION("error") {
+    const auto input = std::string("v 1 2 3\nbad 0 1 2\n");
+
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{"unrecognized line prefix 'bad'"});
+  }
+}
+
+#if defined(__linux__)
+TEST_CASE("READ - file", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+  auto position_count = std::uint32_t{0};
+  auto add_position = MakeObjAddFunc<ObjPositionType>(
+      [&position_count](const auto&) { ++position_count; });
+  auto face_count = std::uint32_t{0};
+  auto add_face = MakeObjAddFunc<ObjFaceType>(
+      [&face_count](const auto&) { ++face_count; });
+
+  SECTION("mapped") {
+    const auto filename = std::string("./read_file_test.obj");
+    {
+      auto ofs = std::ofstream(filename);
+      ofs << "v 1 2 3\n"
+             "v 4 5 6\n"
+             "v 7 8 9\n"
+             "f 1 2 3\n";
+    }
+
+    const auto result =
+        thinks::ReadObjFile(filename.c_str(), add_position, add_face);
+    std::remove(filename.c_str());
+
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 1);
+    REQUIRE(position_count == 3);
+    REQUIRE(face_count == 1);
+  }
+
+  SECTION("missing file") {
+    REQUIRE_THROWS_AS(
+        thinks::ReadObjFile("./no_such_file.obj", add_position, add_face),
+        std::runtime_error);
+  }
+
+  SECTION("fifo") {
+    // Not a regular file, reports a size of zero.
+    const auto filename = std::string("./read_file_test.fifo");
+    std::remove(filename.c_str());
+    REQUIRE(::mkfifo(filename.c_str(), 0600) == 0);
+
+    // Opening a FIFO blocks until both ends are open.
+    auto writer = std::thread([&filename]() {
+      auto ofs = std::ofstream(filename);
+      ofs << "v 1 2 3\n"
+             "v 4 5 6\n"
+             "v 7 8 9\n"
+             "f 1 2 3\n";
+    });
+    auto result = thinks::ObjReadResult{};
+    try {
+      result = thinks::ReadObjFile(filename.c_str(), add_position, add_face);
+    } catch (...) {
+      writer.join();
+      std::remove(filename.c_str());
+      throw;
+    }
+    writer.join();
+    std::remove(filename.c_str());
+
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 1);
+    REQUIRE(position_count == 3);
+    REQUIRE(face_count == 1);
+  }
+}
+#endif  // defined(__linux__)
+
+template <typename FloatT>
+void CheckFloatingPointValues(const std::vector<std::string>& value_strings) {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<FloatT, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+  // Three values per position line.
+  auto input = std::string{};
+  for (std::size_t i = 0; i + 2 < value_strings.size(); i += 3) {
+    input += "v " + value_strings[i] + " " + value_strings[i + 1] + " " +
+             value_strings[i + 2] + "\n";
+  }
+
+  auto values = std::vector<FloatT>{};
+  auto add_position =
+      MakeObjAddFunc<ObjPositionType>([&values](const auto& pos) {
+        values.insert(values.end(), pos.values.begin(), pos.values.end());
+      });
+  auto add_face = MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+  thinks::ReadObj(input.data(), input.size(), add_position, add_face);
+
+  REQUIRE(values.size() == value_strings.size() / 3 * 3);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    auto iss = std::istringstream(value_strings[i]);
+    auto expected = FloatT{};
+    iss >> expected;
+
+    // Bitwise comparison, also distinguishes signed zeros.
+    INFO("value string: " << value_strings[i]);
+    REQUIRE(std::memcmp(&values[i], &expected, sizeof(FloatT)) == 0);
+  }
+}
+
+TEST_CASE("READ - floating point values", "[container]") {
+  auto value_strings = std::vector<std::string>{
+      "0", "-0", "+0.0", "1", "-1", "+1.5", ".5", "5.", "-.25", "1e10",
+      "1E-5", "2.5e+3", "0.1", "0.2", "0.3", "3.4028235e38", "1.17549435e-38",
+      "1.4e-45", "0.30000000000000004", "123456789012345678901234567890",
+      "0.000000000000000000000000000000000000001", "4.9406564584124654e-324",
+      "16777217", "9007199254740993", "00000.00001",
+      "1.00000005960464477539062500000001"};
+
+  // Random values of varying magnitude and precision.
+  auto rng = std::mt19937{1234};
+  auto mantissa_dist = std::uniform_real_distribution<double>{-1.0, 1.0};
+  auto exponent_dist = std::uniform_int_distribution<int>{-40, 40};
+  for (auto i = 0; i < 3000; ++i) {
+    const auto value =
+        std::ldexp(mantissa_dist(rng), exponent_dist(rng));
+    auto oss = std::ostringstream{};
+    oss << std::setprecision(1 + i % 17);
+    if (i % 3 == 1) {
+      oss << std::scientific;
+    }
+    oss << value;
+    value_strings.push_back(oss.str());
+  }
+
+  SECTION("float") { CheckFloatingPointValues<float>(value_strings); }
+  SECTION("double") {
+    // Out of range for float.
+    value_strings.push_back("1.7976931348623157e308");
+    value_strings.push_back("-1e300");
+    value_strings.push_back("2.2250738585072014e-308");
+    CheckFloatingPointValues<double>(value_strings);
+  }
+}
+
+TEST_CASE("READ - parallel", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+  using ObjNormalType = thinks::ObjNormal<float>;
+  using ObjFaceType =
+      thinks::ObjPolygonFace<thinks::ObjIndexGroup<std::uint32_t>>;
+
+  // Large enough to be split into several chunks.
+  auto input = std::string{};
+  for (auto i = 0; i < 20000; ++i) {
+    const auto n = std::to_string(i);
+    input += "v " + n + " 1 2\n";
+    input += "vt 0." + n + " 1\n";
+    input += "# comment " + n + "\n";
+    input += "vn 0 " + n + " 1\n";
+    input += "f 1/1/1 2/2/2 " + std::to_string(i % 9 + 3) + "/3/3" +
+             (i % 2 == 0 ? " 4/4/4\n" : "\n");
+  }
+
+  // Record all callbacks as text, in call order.
+  const auto read = [](const std::string& buffer, const bool parallel,
+                       std::vector<std::string>* const calls) {
+    auto add_position =
+        MakeObjAddFunc<ObjPositionType>([calls](const auto& pos) {
+          calls->push_back("v " + std::to_string(pos.values[0]));
+        });
+    auto add_tex_coord =
+        MakeObjAddFunc<ObjTexCoordType>([calls](const auto& tex) {
+          calls->push_back("vt " + std::to_string(tex.values[0]));
+        });
+    auto add_normal = MakeObjAddFunc<ObjNormalType>([calls](const auto& nml) {
+      calls->push_back("vn " + std::to_string(nml.values[1]));
+    });
+    auto add_face = MakeObjAddFunc<ObjFaceType>([calls](const auto& face) {
+      auto call = std::string("f");
+      for (const auto& idx : face.values) {
+        call += " " + std::to_string(idx.position_index.value);
+      }
+      calls->push_back(call);
+    });
+
+    return parallel ? thinks::ReadObjParallel(
+                          buffer.data(), buffer.size(), add_position,
+                          add_face, add_tex_coord, add_normal,
+                          /* thread_count */ 4)
+                    : thinks::ReadObj(buffer.data(), buffer.size(),
+                                      add_position, add_face, add_tex_coord,
+                                      add_normal);
+  };
+
+  SECTION("same callbacks as serial read") {
+    auto serial_calls = std::vector<std::string>{};
+    auto parallel_calls = std::vector<std::string>{};
+    const auto serial_result = read(input, false, &serial_calls);
+    const auto parallel_result = read(input, true, &parallel_calls);
+
+    REQUIRE(parallel_result.position_count == serial_result.position_count);
+    REQUIRE(parallel_result.face_count == serial_result.face_count);
+    REQUIRE(parallel_result.tex_coord_count ==
+            serial_result.tex_coord_count);
+    REQUIRE(parallel_result.normal_count == serial_result.normal_count);
+    REQUIRE(parallel_calls == serial_calls);
+  }
+
+  SECTION("error") {
+    // Error in the middle of the input, callbacks for preceding lines
+    // must still be called.
+    const auto bad_input = input.substr(0, input.size() / 2) +
+                           "\nvt 0 2\n" + input.substr(input.size() / 2);
+
+    auto serial_calls = std::vector<std::string>{};
+    auto parallel_calls = std::vector<std::string>{};
+    REQUIRE_THROWS_MATCHES(
+        read(bad_input, false, &serial_calls), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+    REQUIRE_THROWS_MATCHES(
+        read(bad_input, true, &parallel_calls), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+    REQUIRE(parallel_calls == serial_calls);
+  }
+
+  SECTION("slow callbacks") {
+    // Workers wait for delivery to catch up instead of parsing ahead.
+    const auto read_slow = [](const std::string& buffer, const bool parallel,
+                              std::vector<std::string>* const calls) {
+      auto add_position =
+          MakeObjAddFunc<ObjPositionType>([calls](const auto& pos) {
+            if (calls->size() % 20000 == 0) {
+              std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            calls->push_back("v " + std::to_string(pos.values[0]));
+          });
+      auto add_face = MakeObjAddFunc<ObjFaceType>(
+          [calls](const auto&) { calls->push_back("f"); });
+
+      return parallel ? thinks::ReadObjParallel(buffer.data(), buffer.size(),
+                                                add_position, add_face,
+                                                nullptr, nullptr,
+                                                /* thread_count */ 2)
+                      : thinks::ReadObj(buffer.data(), buffer.size(),
+                                        add_position, add_face);
+    };
+
+    auto serial_calls = std::vector<std::string>{};
+    auto parallel_calls = std::vector<std::string>{};
+    const auto serial_result = read_slow(input, false, &serial_calls);
+    const auto parallel_result = read_slow(input, true, &parallel_calls);
+    REQUIRE(parallel_result.position_count == serial_result.position_count);
+    REQUIRE(parallel_calls == serial_calls);
+
+    // Error in the last chunk, while workers wait.
+    const auto bad_input = input + "v 1 2\n";
+    serial_calls.clear();
+    parallel_calls.clear();
+    REQUIRE_THROWS(read_slow(bad_input, false, &serial_calls));
+    REQUIRE_THROWS(read_slow(bad_input, true, &parallel_calls));
+    REQUIRE(parallel_calls == serial_calls);
+  }
+}
+
+TEST_CASE("READ - batch", "[container]") {
+  using thinks::MakeObjAddBatchFunc;
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+
+  const auto input = std::string(
+      "v 0 1 2\n"
+      "v 3 4 5\n"
+      "f 1 2 3\n"
+      "v 6 7 8\n"
+      "v 9 10 11\n"
+      "v 12 13 14\n");
+
+  auto positions = std::vector<float>{};
+  auto batch_sizes = std::vector<std::size_t>{};
+  auto add_position = MakeObjAddBatchFunc<ObjPositionType>(
+      [&positions, &batch_sizes](const ObjPositionType* const pos,
+                                 const std::size_t count) {
+        // Batches are contiguous.
+        const auto offset = positions.size();
+        positions.resize(offset + 3 * count);
+        std::memcpy(positions.data() + offset, pos,
+                    count * sizeof(ObjPositionType));
+        batch_sizes.push_back(count);
+      },
+      /* batch_size */ 2);
+  auto face_count = std::size_t{0};
+  auto add_face = MakeObjAddBatchFunc<ObjFaceType>(
+      [&face_count](const ObjFaceType* const, const std::size_t count) {
+        face_count += count;
+      });
+
+  SECTION("buffer") {
+    const auto result =
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face);
+
+    REQUIRE(result.position_count == 5);
+    REQUIRE(face_count == 1);
+    REQUIRE(batch_sizes == std::vector<std::size_t>{2, 2, 1});
+    for (auto i = std::size_t{0}; i < positions.size(); ++i) {
+      REQUIRE(positions[i] == static_cast<float>(i));
+    }
+  }
+
+  SECTION("stream") {
+    auto iss = std::istringstream(input);
+    const auto result = thinks::ReadObj(iss, add_position, add_face);
+
+    REQUIRE(result.position_count == 5);
+    REQUIRE(face_count == 1);
+    REQUIRE(batch_sizes == std::vector<std::size_t>{2, 2, 1});
+  }
+
+  SECTION("parallel") {
+    const auto result = thinks::ReadObjParallel(
+        input.data(), input.size(), add_position, add_face, nullptr, nullptr,
+        /* thread_count */ 4);
+
+    REQUIRE(result.position_count == 5);
+    REQUIRE(face_count == 1);
+    REQUIRE(batch_sizes == std::vector<std::size_t>{2, 2, 1});
+  }
+
+  SECTION("error") {
+    // Elements preceding the error are passed on.
+    const auto bad_input = input + "v 1 2\n";
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(bad_input.data(), bad_input.size(), add_position,
+                        add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+    REQUIRE(batch_sizes == std::vector<std::size_t>{2, 2, 1});
+  }
+
+  SECTION("throwing callback") {
+    // A rejected batch is not passed on again when the error propagates.
+    const auto read_throwing = [&input, &add_face](const std::size_t batch_size,
+                                                   const bool stream) {
+      auto call_count = 0;
+      auto add_throwing = MakeObjAddBatchFunc<ObjPositionType>(
+          [&call_count](const ObjPositionType* const, const std::size_t) {
+            ++call_count;
+            throw std::runtime_error("rejected");
+          },
+          batch_size);
+      auto iss = std::istringstream(input);
+      REQUIRE_THROWS_MATCHES(
+          stream ? thinks::ReadObj(iss, add_throwing, add_face)
+                 : thinks::ReadObj(input.data(), input.size(), add_throwing,
+                                   add_face),
+          std::runtime_error, ExceptionContentMatcher{"rejected"});
+      return call_count;
+    };
+
+    // Full batch while parsing, and remaining elements after parsing.
+    REQUIRE(read_throwing(2, false) == 1);
+    REQUIRE(read_throwing(2, true) == 1);
+    REQUIRE(read_throwing(1024, false) == 1);
+    REQUIRE(read_throwing(1024, true) == 1);
+  }
+}
+
+TEST_CASE("READ - status", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+
+  auto position_count = 0;
+  auto add_position = MakeObjAddFunc<ObjPositionType>(
+      [&position_count](const auto&) { ++position_count; });
+  auto add_face = MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+
+  SECTION("ok") {
+    const auto input = std::string("v 0 1 2\nf 1 1 1\n");
+    auto status = thinks::ObjReadStatus{};
+    const auto result = thinks::TryReadObj(input.data(), input.size(),
+                                           &status, add_position, add_face);
+
+    REQUIRE(status.ok());
+    REQUIRE(status.code() == thinks::ObjReadErrorCode::kOk);
+    REQUIRE(status.line() == 0);
+    REQUIRE(result.position_count == 1);
+    REQUIRE(result.face_count == 1);
+  }
+
+  SECTION("error location") {
+    const auto input = std::string("v 0 1 2\n# comment\nv 3 4 5\nf 1 2 x\n");
+    auto buffer_status = thinks::ObjReadStatus{};
+    const auto result = thinks::TryReadObj(
+        input.data(), input.size(), &buffer_status, add_position, add_face);
+    auto iss = std::istringstream(input);
+    auto stream_status = thinks::ObjReadStatus{};
+    thinks::TryReadObj(iss, &stream_status, add_position, add_face);
+
+    for (const auto& status : {buffer_status, stream_status}) {
+      REQUIRE(!status.ok());
+      REQUIRE(status.code() == thinks::ObjReadErrorCode::kParseFailed);
+      REQUIRE(status.line() == 4);
+      REQUIRE(status.byte_offset() == 26);
+      REQUIRE(status.message() == "failed parsing 'x'");
+    }
+
+    // Positions preceding the error were added.
+    REQUIRE(result.position_count == 2);
+    REQUIRE(position_count == 4);
+  }
+
+  SECTION("same message as exception") {
+    const auto inputs = {
+        std::string("v 0 1\n"), std::string("f 1 2\n"),
+        std::string("f 0 1 2\n"), std::string("v 0 1 2 3 4\n"),
+        std::string("v 0 1 abc\n"), std::string("g group\n")};
+    for (const auto& input : inputs) {
+      auto status = thinks::ObjReadStatus{};
+      thinks::TryReadObj(input.data(), input.size(), &status, add_position,
+                         add_face);
+      REQUIRE(!status.ok());
+      REQUIRE_THROWS_MATCHES(
+          thinks::ReadObj(input.data(), input.size(), add_position,
+                          add_face),
+          std::runtime_error, ExceptionContentMatcher{status.message()});
+    }
+  }
+
+  SECTION("long token") {
+    const auto input = "v 0 1 " + std::string(100, 'x') + "\n";
+    auto status = thinks::ObjReadStatus{};
+    thinks::TryReadObj(input.data(), input.size(), &status, add_position,
+                       add_face);
+    REQUIRE(status.message() ==
+            "failed parsing '" + std::string(64, 'x') + "...'");
+  }
+}
+
+TEST_CASE("READ - stream parser", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+  using ObjFaceType =
+      thinks::ObjPolygonFace<thinks::ObjIndexGroup<std::uint32_t>>;
+
+  // No newline at the end and a mix of line endings.
+  const auto input = std::string(
+      "# comment\n"
+      "v 0.1 1 2\r\n"
+      "vt 0.25 0.5\n"
+      "\n"
+      "v 3 4 5.25\n"
+      "v 6 7 8\n"
+      "f 1/1 2/1 3/1\r\n"
+      "v 9 10 11");
+
+  // Record all callbacks as text, in call order.
+  auto calls = std::vector<std::string>{};
+  auto add_position =
+      MakeObjAddFunc<ObjPositionType>([&calls](const auto& pos) {
+        calls.push_back("v " + std::to_string(pos.values[0]) + " " +
+                        std::to_string(pos.values[2]));
+      });
+  auto add_tex_coord =
+      MakeObjAddFunc<ObjTexCoordType>([&calls](const auto& tex) {
+        calls.push_back("vt " + std::to_string(tex.values[0]));
+      });
+  auto add_face = MakeObjAddFunc<ObjFaceType>([&calls](const auto& face) {
+    auto call = std::string("f");
+    for (const auto& idx : face.values) {
+      call += " " + std::to_string(idx.position_index.value);
+    }
+    calls.push_back(call);
+  });
+
+  const auto expected_result =
+      thinks::ReadObj(input.data(), input.size(), add_position, add_face,
+                      add_tex_coord);
+  const auto expected_calls = calls;
+
+  SECTION("chunks") {
+    for (const auto chunk_size : {1, 2, 3, 7, 16, 1000}) {
+      calls.clear();
+      auto parser =
+          thinks::MakeObjStreamParser(add_position, add_face, add_tex_coord);
+      for (auto i = std::size_t{0}; i < input.size(); i += chunk_size) {
+        parser.Feed(input.data() + i,
+                    std::min(input.size() - i, std::size_t(chunk_size)));
+      }
+      const auto result = parser.Finish();
+
+      REQUIRE(result.position_count == expected_result.position_count);
+      REQUIRE(result.face_count == expected_result.face_count);
+      REQUIRE(result.tex_coord_count == expected_result.tex_coord_count);
+      REQUIRE(result.normal_count == expected_result.normal_count);
+      REQUIRE(calls == expected_calls);
+    }
+  }
+
+  SECTION("error") {
+    auto parser = thinks::MakeObjStreamParser(add_position, add_face);
+    parser.Feed("v 0 1 2\nv 3 ", 12);
+    REQUIRE(parser.result().position_count == 1);
+    REQUIRE_THROWS_MATCHES(
+        parser.Feed("4\n", 2), std::runtime_error,
+        ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+  }
+}
+
+#if defined(THINKS_OBJ_IO_COROUTINES)
+TEST_CASE("READ - generator", "[container]") {
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+  using ObjNormalType = thinks::ObjNormal<float>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+  using ReaderType = thinks::ObjReader<ObjPositionType, ObjFaceType,
+                                       ObjTexCoordType, ObjNormalType>;
+
+  const auto input = std::string(
+      "# comment\n"
+      "v 0 1 2\n"
+      "vt 0.5 1\n"
+      "vn 0 0 1\n"
+      "f 1 2 3\n"
+      "v 3 4 5\n");
+
+  SECTION("elements in order") {
+    const auto reader = ReaderType(input.data(), input.size());
+    auto kinds = std::vector<std::size_t>{};
+    for (const auto& element : reader.Elements()) {
+      kinds.push_back(element.index());
+    }
+    REQUIRE(kinds == std::vector<std::size_t>{0, 2, 3, 1, 0});
+  }
+
+  SECTION("values") {
+    const auto reader = ReaderType(input.data(), input.size());
+    auto elements = reader.Elements();
+    auto it = elements.begin();
+    REQUIRE(std::get<ObjPositionType>(*it).values[2] == 2.F);
+    ++it;
+    REQUIRE(std::get<ObjTexCoordType>(*it).values[0] == 0.5F);
+  }
+
+  SECTION("error") {
+    const auto bad_input = input + "v 1 2\n";
+    const auto reader = ReaderType(bad_input.data(), bad_input.size());
+    auto count = 0;
+    auto consume = [&]() {
+      for (const auto& element : reader.Elements()) {
+        (void)element;
+        ++count;
+      }
+    };
+    REQUIRE_THROWS_MATCHES(
+        consume(), std::runtime_error,
+        ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+    REQUIRE(count == 5);
+  }
+}
+#endif  // defined(THINKS_OBJ_IO_COROUTINES)
+
+TEST_CASE("READ - arrays", "[container]") {
+  const auto input = std::string(
+      "v 0 1 2\n"
+      "v 3 4 5\n"
+      "v 6 7 8\n"
+      "vt 0 0.5\n"
+      "vn 0 0 1\n"
+      "f 1 2 3\n"
+      "f 3 2 1\n");
+
+  SECTION("count and fill") {
+    // First pass with null arrays only counts.
+    const auto count_result =
+        thinks::ReadObjArrays(input.data(), input.size(), thinks::ObjArrays{});
+    REQUIRE(count_result.position_count == 3);
+    REQUIRE(count_result.face_count == 2);
+    REQUIRE(count_result.tex_coord_count == 1);
+    REQUIRE(count_result.normal_count == 1);
+
+    auto positions = std::vector<float>(3 * count_result.position_count);
+    auto triangles = std::vector<std::uint32_t>(3 * count_result.face_count);
+    auto tex_coords = std::vector<float>(2 * count_result.tex_coord_count);
+    auto normals = std::vector<float>(3 * count_result.normal_count);
+    auto arrays = thinks::ObjArrays{};
+    arrays.positions = positions.data();
+    arrays.position_capacity = count_result.position_count;
+    arrays.triangle_indices = triangles.data();
+    arrays.triangle_capacity = count_result.face_count;
+    arrays.tex_coords = tex_coords.data();
+    arrays.tex_coord_capacity = count_result.tex_coord_count;
+    arrays.normals = normals.data();
+    arrays.normal_capacity = count_result.normal_count;
+
+    auto iss = std::istringstream(input);
+    const auto result = thinks::ReadObjArrays(iss, arrays);
+
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 2);
+    REQUIRE(positions ==
+            std::vector<float>{0.F, 1.F, 2.F, 3.F, 4.F, 5.F, 6.F, 7.F, 8.F});
+    REQUIRE(triangles == std::vector<std::uint32_t>{0, 1, 2, 2, 1, 0});
+    REQUIRE(tex_coords == std::vector<float>{0.F, 0.5F});
+    REQUIRE(normals == std::vector<float>{0.F, 0.F, 1.F});
+  }
+
+  SECTION("capacity exceeded") {
+    auto positions = std::vector<float>(3 * 2);
+    auto arrays = thinks::ObjArrays{};
+    arrays.positions = positions.data();
+    arrays.position_capacity = 2;
+
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjArrays(input.data(), input.size(), arrays),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "position array capacity exceeded (capacity 2)"});
+  }
+
+  SECTION("polygons, index groups and uvw") {
+    const auto polygon_input = std::string(
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "vt 0 0.5 1\n"
+        "vt 1 0.5\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/1/1 4/2/1\n"
+        "f 1//1 2//1 3//1\n"
+        "f 4/1 3/2 2/1\n"
+        "f 1 3 4\n");
+
+    // Four faces, five triangles.
+    const auto count_result = thinks::ReadObjArrays(
+        polygon_input.data(), polygon_input.size(), thinks::ObjArrays{});
+    REQUIRE(count_result.face_count == 5);
+    const auto obj_count = thinks::CountObj(polygon_input.data(),
+                                            polygon_input.size());
+    REQUIRE(obj_count.face_index_count - 2 * obj_count.face_count == 5);
+
+    auto triangles = std::vector<std::uint32_t>(3 * count_result.face_count);
+    auto tex_coords = std::vector<float>(2 * count_result.tex_coord_count);
+    auto arrays = thinks::ObjArrays{};
+    arrays.triangle_indices = triangles.data();
+    arrays.triangle_capacity = count_result.face_count;
+    arrays.tex_coords = tex_coords.data();
+    arrays.tex_coord_capacity = count_result.tex_coord_count;
+    thinks::ReadObjArrays(polygon_input.data(), polygon_input.size(), arrays);
+
+    REQUIRE(triangles == std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3, 0, 1, 2,
+                                                    3, 2, 1, 0, 2, 3});
+    REQUIRE(tex_coords == std::vector<float>{0.F, 0.5F, 1.F, 0.5F});
+  }
+
+  SECTION("rejected input") {
+    const auto read = [](const std::string& bad_input) {
+      return thinks::ReadObjArrays(bad_input.data(), bad_input.size(),
+                                   thinks::ObjArrays{});
+    };
+
+    REQUIRE_THROWS_MATCHES(
+        read("f 1 2\n"), std::runtime_error,
+        ExceptionContentMatcher{
+            "faces must have at least 3 indices (found 2)"});
+    REQUIRE_THROWS_MATCHES(
+        read("f 1/1/1/1 2 3\n"), std::runtime_error,
+        ExceptionContentMatcher{
+            "index group can have at most 3 tokens ('1/1/1/1')"});
+    REQUIRE_THROWS_MATCHES(
+        read("vt 0 1 1 1\n"), std::runtime_error,
+        ExceptionContentMatcher{"expected to parse at most 3 values"});
+    REQUIRE_THROWS_MATCHES(
+        read("vt 0 2\n"), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+  }
+}
+
+TEST_CASE("READ - unified", "[container]") {
+  SECTION("index groups") {
+    const auto input = std::string(
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "vt 0 0\n"
+        "vt 1 1\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/1/1 4/2/1\n"
+        "f 1/1/1 3/1/1 2/2/1\n");
+
+    const auto mesh = thinks::ReadObjUnified(input.data(), input.size());
+
+    REQUIRE(mesh.indices == std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3, 0, 2,
+                                                       1});
+    REQUIRE(mesh.positions == std::vector<float>{0.f, 0.f, 0.f, 1.f, 0.f, 0.f,
+                                                 1.f, 1.f, 0.f, 0.f, 1.f,
+                                                 0.f});
+    REQUIRE(mesh.tex_coords ==
+            std::vector<float>{0.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f});
+    REQUIRE(mesh.normals == std::vector<float>{0.f, 0.f, 1.f, 0.f, 0.f, 1.f,
+                                               0.f, 0.f, 1.f, 0.f, 0.f,
+                                               1.f});
+  }
+
+  SECTION("positions only") {
+    auto iss = std::istringstream(
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "f 1 2 3\n"
+        "f 3 2 1\n");
+
+    const auto mesh = thinks::ReadObjUnified<std::uint16_t>(iss);
+
+    REQUIRE(mesh.indices == std::vector<std::uint16_t>{0, 1, 2, 2, 1, 0});
+    REQUIRE(mesh.positions.size() == 9);
+    REQUIRE(mesh.tex_coords.empty());
+    REQUIRE(mesh.normals.empty());
+  }
+
+  SECTION("index range") {
+    const auto input = std::string(
+        "v 0 0 0\n"
+        "f 1 1 2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjUnified(input.data(), input.size()),
+        std::runtime_error,
+        ExceptionContentMatcher{"position index 2 out of range (count 1)"});
+  }
+
+  SECTION("index type range") {
+    auto input = std::string("v 0 0 0\n");
+    for (auto i = 1; i <= 66000; i += 3) {
+      input += "f " + std::to_string(i) + " " + std::to_string(i + 1) + " " +
+               std::to_string(i + 2) + "\n";
+    }
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjUnified<std::uint16_t>(input.data(), input.size()),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "unified vertex count exceeds index type range (max 65535)"});
+  }
+}
+
+TEST_CASE("READ - options", "[container]") {
+  using thinks::ObjReadFlags;
+  using thinks::ObjReadOptions;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+  using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+
+  auto positions = std::vector<ObjPositionType>{};
+  auto tex_coords = std::vector<ObjTexCoordType>{};
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&positions](const auto& pos) { positions.push_back(pos); });
+  auto add_face = thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+  auto add_tex_coord = thinks::MakeObjAddFunc<ObjTexCoordType>(
+      [&tex_coords](const auto& tex) { tex_coords.push_back(tex); });
+
+  SECTION("no validation") {
+    const auto input = std::string("vt 0.5 2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face,
+                        add_tex_coord),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+
+    const auto result =
+        thinks::ReadObj<ObjReadOptions<ObjReadFlags::kNoValidation>>(
+            input.data(), input.size(), add_position, add_face,
+            add_tex_coord);
+    REQUIRE(result.tex_coord_count == 1);
+    REQUIRE(tex_coords.back().values[1] == 2.f);
+  }
+
+  SECTION("trusted input") {
+    const auto input = std::string("v 1 2 3 4\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "expected to parse at most 3 values"});
+
+    auto iss = std::istringstream(input);
+    auto status = thinks::ObjReadStatus{};
+    const auto result =
+        thinks::TryReadObj<ObjReadOptions<ObjReadFlags::kTrustedInput>>(
+            iss, &status, add_position, add_face);
+    REQUIRE(status.ok());
+    REQUIRE(result.position_count == 1);
+    REQUIRE(positions.back().values ==
+            ObjPositionType{1.f, 2.f, 3.f}.values);
+  }
+}
+
+TEST_CASE("COUNT", "[container]") {
+  const auto input = std::string(
+      "# comment v 1 2 3\n"
+      "\n"
+      "v 1 2 3\n"
+      "  v 4 5 6\n"
+      "v 7 8 9\n"
+      "v 7 8 9\n"
+      "vt 0 0\n"
+      "vt 0 1\n"
+      "vn 1 0 0\n"
+      "f 1/1/1 2/2/1 3/1/1\n"
+      "f 1 2 3 4\r\n"
+      "f\t1  2 3 4 5   \n"
+      "vp 1 2 3\n"
+      "f 1 2 3");
+
+  SECTION("buffer") {
+    const auto result = thinks::CountObj(input.data(), input.size());
+
+    REQUIRE(result.position_count == 4);
+    REQUIRE(result.face_count == 4);
+    REQUIRE(result.tex_coord_count == 2);
+    REQUIRE(result.normal_count == 1);
+    REQUIRE(result.face_index_count == 3 + 4 + 5 + 3);
+  }
+
+  SECTION("stream") {
+    auto iss = std::istringstream(input);
+    const auto result = thinks::CountObj(iss);
+
+    REQUIRE(result.position_count == 4);
+    REQUIRE(result.face_count == 4);
+    REQUIRE(result.tex_coord_count == 2);
+    REQUIRE(result.normal_count == 1);
+    REQUIRE(result.face_index_count == 3 + 4 + 5 + 3);
+  }
+}
+
 TEST_CASE("READ - unrecognized line prefix") {
   using MeshType = Mesh<>;
 
@@ -321,6 +1398,100 @@ TEST_CASE("READ - unrecognized line prefix") {
       ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
       std::runtime_error,
       ExceptionContentMatcher{"unrecognized line prefix 'bad'"});
+
+  // Prefixes sharing leading characters with known prefixes.
+  for (const auto prefix : {"vp", "vtn", "fo", "vv", "x"}) {
+    auto prefix_iss = std::istringstream(std::string(prefix) + " 0 1 2\n");
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(prefix_iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{"unrecognized line prefix '" +
+                                std::string(prefix) + "'"});
+  }
+}
+
+TEST_CASE("READ - unknown lines", "[container]") {
+  using thinks::MakeObjAddFunc;
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+
+  const auto input = std::string(
+      "mtllib cube.mtl\n"
+      "o cube\n"
+      "v 0 1 2\n"
+      "v 3 4 5\n"
+      "v 6 7 8\n"
+      "g side  \r\n"
+      "usemtl  red material\n"
+      "s off\n"
+      "f 1 2 3\n"
+      "l 1 2\n");
+
+  auto add_position = MakeObjAddFunc<ObjPositionType>([](const auto&) {});
+  auto add_face = MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+
+  auto lines = std::vector<std::pair<std::string, std::string>>{};
+  auto add_unknown_line = MakeObjAddFunc<thinks::ObjUnknownLine>(
+      [&lines](const thinks::ObjUnknownLine& line) {
+        lines.emplace_back(std::string(line.prefix, line.prefix_size),
+                           std::string(line.rest, line.rest_size));
+      });
+  const auto expected_lines = std::vector<std::pair<std::string, std::string>>{
+      {"mtllib", "cube.mtl"}, {"o", "cube"},  {"g", "side"},
+      {"usemtl", "red material"}, {"s", "off"}, {"l", "1 2"}};
+
+  SECTION("skip") {
+    const auto result = thinks::ReadObj(
+        input.data(), input.size(), add_position, add_face, nullptr, nullptr,
+        thinks::MakeObjSkipUnknownLinesFunc());
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 1);
+  }
+
+  SECTION("forward") {
+    auto iss = std::istringstream(input);
+    const auto result = thinks::ReadObj(iss, add_position, add_face, nullptr,
+                                        nullptr, add_unknown_line);
+    REQUIRE(result.position_count == 3);
+    REQUIRE(result.face_count == 1);
+    REQUIRE(lines == expected_lines);
+  }
+
+  SECTION("forward parallel") {
+    // Large enough to be split into several chunks.
+    auto large_input = std::string{};
+    for (auto i = 0; i < 5000; ++i) {
+      large_input += input;
+    }
+
+    thinks::ReadObj(large_input.data(), large_input.size(), add_position,
+                    add_face, nullptr, nullptr, add_unknown_line);
+    const auto serial_lines = lines;
+    lines.clear();
+    const auto result = thinks::ReadObjParallel(
+        large_input.data(), large_input.size(), add_position, add_face,
+        nullptr, nullptr, /* thread_count */ 4, add_unknown_line);
+    REQUIRE(result.position_count == 3 * 5000);
+    REQUIRE(lines.size() == expected_lines.size() * 5000);
+    REQUIRE(lines == serial_lines);
+  }
+
+  SECTION("forward stream parser") {
+    auto parser = thinks::MakeObjStreamParser(add_position, add_face, nullptr,
+                                              nullptr, add_unknown_line);
+    for (const auto c : input) {
+      parser.Feed(&c, 1);
+    }
+    parser.Finish();
+    REQUIRE(lines == expected_lines);
+  }
+
+  SECTION("strict") {
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{"unrecognized line prefix 'mtllib'"});
+  }
 }
 
 TEST_CASE("READ - position errors", "[container]") {
@@ -547,6 +1718,55 @@ TEST_CASE("READ - index range", "[container]") {
         ExceptionContentMatcher{
             "parsed index must be greater than zero"});
   }
+
+  SECTION("negative index") {
+    const auto input = std::string("f 1 -2 3\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "parsed index must be greater than zero"});
+  }
+
+  SECTION("index overflow") {
+    const auto input = std::string("f 1 2 40000\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{"failed parsing '40000'"});
+  }
+
+  SECTION("64-bit indices") {
+    using ObjFaceType =
+        thinks::ObjTriangleFace<thinks::ObjIndex<std::uint64_t>>;
+
+    auto faces = std::vector<ObjFaceType>{};
+    auto add_position =
+        thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+            [](const auto&) {});
+    auto add_face = thinks::MakeObjAddFunc<ObjFaceType>(
+        [&faces](const auto& face) { faces.push_back(face); });
+
+    const auto input =
+        std::string("f 1 4294967297 18446744073709551615\n");
+    const auto result =
+        thinks::ReadObj(input.data(), input.size(), add_position, add_face);
+    REQUIRE(result.face_count == 1);
+    REQUIRE(faces[0].values[1].value == std::uint64_t{4294967296});
+    REQUIRE(faces[0].values[2].value ==
+            std::numeric_limits<std::uint64_t>::max() - 1);
+
+    const auto overflow_input = std::string("f 1 2 18446744073709551616\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(overflow_input.data(), overflow_input.size(),
+                        add_position, add_face),
+        std::runtime_error,
+        ExceptionContentMatcher{"failed parsing '18446744073709551616'"});
+  }
 }
 
 TEST_CASE("READ - index group errors", "[container]") {
@@ -585,6 +1805,26 @@ TEST_CASE("READ - index group errors", "[container]") {
         ExceptionContentMatcher{
             "index group can have at most 3 tokens ('1/2/3/4')"});
   }
+
+  SECTION("invalid tex coord index") {
+    const auto input = std::string("f 1 2 3/x/3\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadIndexGroupMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{"failed parsing 'x'"});
+  }
+
+  SECTION("zero normal index") {
+    const auto input = std::string("f 1 2 3//0\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadIndexGroupMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{"parsed index must be greater than zero"});
+  }
 }
 
 } // namespace
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <exception>
 #include <iostream>
@@ -159,27 +160,37 @@ WriteResult WriteHelper(PosMapperT&& pos_mapper, FaceMapperT&& face_mapper,
   using thinks::WriteObj;
 
   auto result = thinks::ObjWriteResult{};
-  auto oss = std::ostringstream{};
+  auto str = std::string{};
   if (!write_tex_coords && !write_normals) {
-    result = WriteObj(oss, std::forward<PosMapperT>(pos_mapper),
+    result = WriteObj(&str, std::forward<PosMapperT>(pos_mapper),
                       std::forward<FaceMapperT>(face_mapper));
   } else if (write_tex_coords && !write_normals) {
-    result = WriteObj(oss, std::forward<PosMapperT>(pos_mapper),
+    result = WriteObj(&str, std::forward<PosMapperT>(pos_mapper),
                       std::forward<FaceMapperT>(face_mapper),
                       std::forward<TexMapperT>(tex_mapper));
   } else if (!write_tex_coords && write_normals) {
-    result = WriteObj(oss, std::forward<PosMapperT>(pos_mapper),
+    result = WriteObj(&str, std::forward<PosMapperT>(pos_mapper),
                       std::forward<FaceMapperT>(face_mapper), 
                       nullptr, // No texture coordinates!
                       std::forward<NmlMapperT>(nml_mapper));
   } else {
-    result = WriteObj(oss, std::forward<PosMapperT>(pos_mapper),
+    result = WriteObj(&str, std::forward<PosMapperT>(pos_mapper),
                       std::forward<FaceMapperT>(face_mapper),
                       std::forward<TexMapperT>(tex_mapper),
                       std::forward<NmlMapperT>(nml_mapper));
   }
 
-  return {result, oss.str()};
+  return {result, std::move(str)};
+}
+
+// Counts elements in the stream and rewinds it, so that storage can be
+// reserved up front.
+inline thinks::ObjCountResult CountAndRewind(std::istream& is) {
+  const auto start = is.tellg();
+  const auto count = thinks::CountObj(is);
+  is.clear();
+  is.seekg(start);
+  return count;
 }
 
 }  // namespace read_write_utils_internal
@@ -193,6 +204,12 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
   using VertexType = MeshType::VertexType;
 
   auto mesh = MeshType{};
+  const auto count = read_write_utils_internal::CountAndRewind(is);
+  mesh.vertices.reserve(std::max({count.position_count,
+                                  read_tex_coords ? count.tex_coord_count : 0,
+                                  read_normals ? count.normal_count : 0}));
+  mesh.indices.reserve(count.face_index_count);
+
   auto pos_count = uint32_t{0};
   auto tex_count = uint32_t{0};
   auto nml_count = uint32_t{0};
@@ -287,6 +304,17 @@ ReadResult<IndexedMeshT> ReadIndexGroupMesh(std::istream& is,
   using MeshType = IndexedMeshT;
 
   auto mesh = MeshType{};
+  const auto count = read_write_utils_internal::CountAndRewind(is);
+  mesh.positions.reserve(count.position_count);
+  mesh.position_indices.reserve(count.face_index_count);
+  if (read_tex_coords) {
+    mesh.tex_coords.reserve(count.tex_coord_count);
+    mesh.tex_coord_indices.reserve(count.face_index_count);
+  }
+  if (read_normals) {
+    mesh.normals.reserve(count.normal_count);
+    mesh.normal_indices.reserve(count.face_index_count);
+  }
 
   // Positions.
   using PositionType = MeshType::PositionType;
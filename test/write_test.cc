@@ -2,8 +2,15 @@
 // This file is subject to the license terms in the LICENSE file
 // found in the top-level directory of this distribution.
 
+#include <algorithm>
+#include <cmath>
 #include <exception>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "catch2/catch.hpp"
@@ -383,6 +390,810 @@ TEST_CASE("WRITE - polygons") {
   REQUIRE(expected_string == write_result.mesh_str);
 }
 
+TEST_CASE("WRITE - sink") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using FaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+  // Records the size of each write.
+  struct Sink {
+    void Write(const char* const data, const std::size_t size) {
+      str.append(data, size);
+      write_sizes.push_back(size);
+    }
+
+    std::string str;
+    std::vector<std::size_t> write_sizes;
+  };
+
+  // Large enough to fill several blocks.
+  constexpr auto kPositionCount = 30000;
+  auto write = [](auto&& out) {
+    auto pos_count = 0;
+    auto face_count = 0;
+    return thinks::WriteObj(
+        std::forward<decltype(out)>(out),
+        [&pos_count]() {
+          const auto x = static_cast<float>(pos_count);
+          return pos_count++ == kPositionCount
+                     ? thinks::ObjEnd<PositionType>()
+                     : thinks::ObjMap(PositionType{x, 0.5f * x, 0.25f * x});
+        },
+        [&face_count]() {
+          const auto i = static_cast<std::uint32_t>(face_count);
+          return face_count++ == kPositionCount - 2
+                     ? thinks::ObjEnd<FaceType>()
+                     : thinks::ObjMap(FaceType{
+                           thinks::ObjIndex<std::uint32_t>{i},
+                           thinks::ObjIndex<std::uint32_t>{i + 1},
+                           thinks::ObjIndex<std::uint32_t>{i + 2}});
+        });
+  };
+
+  auto oss = std::ostringstream{};
+  auto sink = Sink{};
+  auto str = std::string("# Existing content\n");
+  const auto os_result = write(oss);
+  const auto sink_result = write(&sink);
+  const auto str_result = write(&str);
+
+  REQUIRE(sink_result.position_count == kPositionCount);
+  REQUIRE(sink_result.face_count == kPositionCount - 2);
+  REQUIRE(os_result.position_count == sink_result.position_count);
+  REQUIRE(str_result.face_count == sink_result.face_count);
+  REQUIRE(sink.str == oss.str());
+  REQUIRE(str == "# Existing content\n" + oss.str());
+
+  // Few large writes.
+  REQUIRE(sink.write_sizes.size() > 1);
+  REQUIRE(sink.write_sizes.size() < sink.str.size() / 32768);
+}
+
+TEST_CASE("WRITE - parallel") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using TexCoordType = thinks::ObjTexCoord<float, 2>;
+  using IndexType = thinks::ObjIndex<std::uint32_t>;
+  using FaceType = thinks::ObjTriangleFace<IndexType>;
+
+  // Several batches per element type.
+  constexpr auto kPositionCount = 20000;
+  auto write = [](auto&& out, const auto& write_func) {
+    auto pos_count = 0;
+    auto tex_count = 0;
+    auto face_count = 0;
+    return write_func(
+        std::forward<decltype(out)>(out),
+        [&pos_count]() {
+          const auto x = static_cast<float>(pos_count);
+          return pos_count++ == kPositionCount
+                     ? thinks::ObjEnd<PositionType>()
+                     : thinks::ObjMap(PositionType{x, 0.5f * x, 0.1f * x});
+        },
+        [&face_count]() {
+          const auto i = static_cast<std::uint32_t>(face_count);
+          return face_count++ == kPositionCount - 2
+                     ? thinks::ObjEnd<FaceType>()
+                     : thinks::ObjMap(FaceType{IndexType{i}, IndexType{i + 1},
+                                               IndexType{i + 2}});
+        },
+        [&tex_count]() {
+          const auto u = static_cast<float>(tex_count) / kPositionCount;
+          return tex_count++ == kPositionCount
+                     ? thinks::ObjEnd<TexCoordType>()
+                     : thinks::ObjMap(TexCoordType{u, 1.f - u});
+        });
+  };
+  const auto write_serial = [](auto&& out, auto&&... mappers) {
+    return thinks::WriteObj(std::forward<decltype(out)>(out),
+                            std::forward<decltype(mappers)>(mappers)...);
+  };
+  const auto write_parallel = [](auto&& out, auto&& pos_mapper,
+                                 auto&& face_mapper, auto&& tex_mapper) {
+    return thinks::WriteObjParallel(
+        std::forward<decltype(out)>(out), pos_mapper, face_mapper, tex_mapper,
+        nullptr, /* thread_count */ 4);
+  };
+
+  auto expected = std::ostringstream{};
+  const auto expected_result = write(expected, write_serial);
+
+  SECTION("output") {
+    auto oss = std::ostringstream{};
+    auto str = std::string{};
+    const auto os_result = write(oss, write_parallel);
+    const auto str_result = write(&str, write_parallel);
+
+    REQUIRE(os_result.position_count == expected_result.position_count);
+    REQUIRE(os_result.tex_coord_count == expected_result.tex_coord_count);
+    REQUIRE(os_result.normal_count == 0);
+    REQUIRE(os_result.face_count == expected_result.face_count);
+    REQUIRE(str_result.face_count == expected_result.face_count);
+    REQUIRE(oss.str() == expected.str());
+    REQUIRE(str == expected.str());
+  }
+
+  SECTION("single thread") {
+    auto str = std::string{};
+    auto pos_count = 0;
+    const auto result = thinks::WriteObjParallel(
+        &str,
+        [&pos_count]() {
+          return pos_count++ == 3 ? thinks::ObjEnd<PositionType>()
+                                  : thinks::ObjMap(PositionType{1.f, 2.f, 3.f});
+        },
+        []() { return thinks::ObjEnd<FaceType>(); }, nullptr, nullptr,
+        /* thread_count */ 1);
+
+    REQUIRE(result.position_count == 3);
+    REQUIRE(str.find("v 1 2 3\nv 1 2 3\nv 1 2 3\n") != std::string::npos);
+  }
+
+  SECTION("validation error") {
+    // Invalid texture coordinate in a later batch.
+    constexpr auto kInvalidIndex = 10000;
+    const auto write_invalid = [](auto&& out, const auto& write_func) {
+      auto pos_count = 0;
+      auto tex_count = 0;
+      return write_func(
+          std::forward<decltype(out)>(out),
+          [&pos_count]() {
+            return pos_count++ == kPositionCount
+                       ? thinks::ObjEnd<PositionType>()
+                       : thinks::ObjMap(PositionType{1.f, 2.f, 3.f});
+          },
+          []() { return thinks::ObjEnd<FaceType>(); },
+          [&tex_count]() {
+            const auto u = tex_count == kInvalidIndex ? 2.f : 0.5f;
+            return tex_count++ == kPositionCount
+                       ? thinks::ObjEnd<TexCoordType>()
+                       : thinks::ObjMap(TexCoordType{u, u});
+          });
+    };
+
+    auto serial = std::ostringstream{};
+    auto parallel = std::ostringstream{};
+    REQUIRE_THROWS_MATCHES(
+        write_invalid(serial, write_serial), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+    REQUIRE_THROWS_MATCHES(
+        write_invalid(parallel, write_parallel), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+
+    // Lines before the invalid one are written.
+    REQUIRE(parallel.str() == serial.str());
+  }
+
+  SECTION("validation error with full queue") {
+    // Invalid texture coordinate in the first batch, followed by many more
+    // batches than two threads keep in flight.
+    constexpr auto kTexCoordCount = 100000;
+    constexpr auto kInvalidIndex = 10;
+    const auto write_invalid = [](auto&& out, const auto& write_func) {
+      auto tex_count = 0;
+      return write_func(
+          std::forward<decltype(out)>(out),
+          []() { return thinks::ObjEnd<PositionType>(); },
+          []() { return thinks::ObjEnd<FaceType>(); },
+          [&tex_count]() {
+            const auto u = tex_count == kInvalidIndex ? 2.f : 0.5f;
+            return tex_count++ == kTexCoordCount
+                       ? thinks::ObjEnd<TexCoordType>()
+                       : thinks::ObjMap(TexCoordType{u, u});
+          });
+    };
+    const auto write_two_threads = [](auto&& out, auto&& pos_mapper,
+                                      auto&& face_mapper, auto&& tex_mapper) {
+      return thinks::WriteObjParallel(
+          std::forward<decltype(out)>(out), pos_mapper, face_mapper,
+          tex_mapper, nullptr, /* thread_count */ 2);
+    };
+
+    auto serial = std::ostringstream{};
+    auto parallel = std::ostringstream{};
+    REQUIRE_THROWS_MATCHES(
+        write_invalid(serial, write_serial), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+    REQUIRE_THROWS_MATCHES(
+        write_invalid(parallel, write_two_threads), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 2)"});
+
+    // Nothing after the invalid line is written.
+    REQUIRE(parallel.str() == serial.str());
+  }
+}
+
+TEST_CASE("WRITE - batch mappers") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using NormalType = thinks::ObjNormal<float>;
+  using IndexType = thinks::ObjIndex<std::uint32_t>;
+  using FaceType = thinks::ObjTriangleFace<IndexType>;
+
+  constexpr auto kPositionCount = std::size_t{1000};
+  auto positions = std::vector<PositionType>{};
+  auto normals = std::vector<NormalType>{};
+  auto faces = std::vector<FaceType>{};
+  for (auto i = std::size_t{0}; i < kPositionCount; ++i) {
+    const auto x = static_cast<float>(i);
+    positions.push_back(PositionType{x, 0.5f * x, 0.25f * x});
+    normals.push_back(NormalType{0.f, 0.f, 1.f});
+  }
+  for (auto i = std::uint32_t{0}; i + 2 < kPositionCount; ++i) {
+    faces.push_back(FaceType{IndexType{i}, IndexType{i + 1}, IndexType{i + 2}});
+  }
+
+  // Copies out of contiguous storage.
+  const auto make_batch_mapper = [](const auto& elements) {
+    using ElementType =
+        typename std::decay<decltype(elements)>::type::value_type;
+    auto iter = elements.begin();
+    return thinks::MakeObjBatchMapFunc<ElementType, 64>(
+        [iter, &elements](ElementType* const out,
+                          const std::size_t max_count) mutable {
+          const auto count = std::min(
+              max_count, static_cast<std::size_t>(elements.end() - iter));
+          std::copy(iter, iter + count, out);
+          iter += count;
+          return count;
+        });
+  };
+  const auto make_mapper = [](const auto& elements) {
+    using ElementType =
+        typename std::decay<decltype(elements)>::type::value_type;
+    auto iter = elements.begin();
+    return [iter, &elements]() mutable {
+      return iter == elements.end() ? thinks::ObjEnd<ElementType>()
+                                    : thinks::ObjMap(*iter++);
+    };
+  };
+
+  auto expected = std::string{};
+  thinks::WriteObj(&expected, make_mapper(positions), make_mapper(faces),
+                   nullptr, make_mapper(normals));
+
+  SECTION("serial") {
+    auto str = std::string{};
+    const auto result =
+        thinks::WriteObj(&str, make_batch_mapper(positions),
+                         make_batch_mapper(faces), nullptr,
+                         make_batch_mapper(normals));
+
+    REQUIRE(result.position_count == kPositionCount);
+    REQUIRE(result.normal_count == kPositionCount);
+    REQUIRE(result.face_count == faces.size());
+    REQUIRE(str == expected);
+  }
+
+  SECTION("mixed") {
+    auto str = std::string{};
+    thinks::WriteObj(&str, make_batch_mapper(positions), make_mapper(faces),
+                     nullptr, make_batch_mapper(normals));
+
+    REQUIRE(str == expected);
+  }
+
+  SECTION("parallel") {
+    auto str = std::string{};
+    const auto result = thinks::WriteObjParallel(
+        &str, make_batch_mapper(positions), make_batch_mapper(faces), nullptr,
+        make_batch_mapper(normals), /* thread_count */ 4);
+
+    REQUIRE(result.face_count == faces.size());
+    REQUIRE(str == expected);
+  }
+
+  SECTION("too many elements") {
+    auto str = std::string{};
+    REQUIRE_THROWS_MATCHES(
+        thinks::WriteObj(
+            &str,
+            thinks::MakeObjBatchMapFunc<PositionType, 2>(
+                [](PositionType* const, const std::size_t) {
+                  return std::size_t{3};
+                }),
+            make_mapper(faces)),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "batch mapper returned too many elements: 3 (max 2)"});
+  }
+}
+
+TEST_CASE("WRITE - arrays") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using TexCoordType = thinks::ObjTexCoord<float, 2>;
+  using NormalType = thinks::ObjNormal<float>;
+  using IndexType = thinks::ObjIndex<std::uint32_t>;
+  using IndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+
+  const auto positions = std::vector<float>{0.f, 0.f,  0.f, 1.f, 0.f,  0.f,
+                                            1.f, 1.f,  0.f, 0.f, 1.f,  0.f,
+                                            0.5f, 2.f, 0.1f};
+  const auto tex_coords = std::vector<float>{0.f, 0.f, 1.f, 0.f, 1.f, 1.f};
+  const auto normals = std::vector<float>{0.f, 0.f, 1.f};
+
+  // Mappers over the same arrays.
+  const auto pos_mapper = [&positions]() {
+    auto i = std::size_t{0};
+    return [&positions, i]() mutable {
+      const auto p = positions.data() + 3 * i;
+      return 3 * i++ == positions.size()
+                 ? thinks::ObjEnd<PositionType>()
+                 : thinks::ObjMap(PositionType{p[0], p[1], p[2]});
+    };
+  };
+  const auto tex_mapper = [&tex_coords]() {
+    auto i = std::size_t{0};
+    return [&tex_coords, i]() mutable {
+      const auto t = tex_coords.data() + 2 * i;
+      return 2 * i++ == tex_coords.size()
+                 ? thinks::ObjEnd<TexCoordType>()
+                 : thinks::ObjMap(TexCoordType{t[0], t[1]});
+    };
+  };
+  const auto nml_mapper = [&normals]() {
+    auto i = std::size_t{0};
+    return [&normals, i]() mutable {
+      const auto n = normals.data() + 3 * i;
+      return 3 * i++ == normals.size()
+                 ? thinks::ObjEnd<NormalType>()
+                 : thinks::ObjMap(NormalType{n[0], n[1], n[2]});
+    };
+  };
+
+  auto arrays = thinks::ObjWriteArrays{};
+  arrays.positions = positions.data();
+  arrays.position_count = positions.size() / 3;
+
+  SECTION("triangles") {
+    using FaceType = thinks::ObjTriangleFace<IndexType>;
+    const auto indices = std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3};
+    arrays.position_indices = indices.data();
+    arrays.face_count = indices.size() / 3;
+
+    auto expected = std::string{};
+    auto face_index = std::size_t{0};
+    thinks::WriteObj(&expected, pos_mapper(), [&indices, &face_index]() {
+      const auto f = indices.data() + 3 * face_index;
+      return 3 * face_index++ == indices.size()
+                 ? thinks::ObjEnd<FaceType>()
+                 : thinks::ObjMap(FaceType{IndexType{f[0]}, IndexType{f[1]},
+                                           IndexType{f[2]}});
+    });
+
+    auto oss = std::ostringstream{};
+    auto str = std::string{};
+    const auto result = thinks::WriteObjArrays(oss, arrays);
+    thinks::WriteObjArrays(&str, arrays);
+
+    REQUIRE(result.position_count == 5);
+    REQUIRE(result.tex_coord_count == 0);
+    REQUIRE(result.normal_count == 0);
+    REQUIRE(result.face_count == 2);
+    REQUIRE(oss.str() == expected);
+    REQUIRE(str == expected);
+  }
+
+  SECTION("polygons") {
+    using FaceType = thinks::ObjSmallPolygonFace<IndexType>;
+    const auto offsets = std::vector<std::uint32_t>{0, 4, 7};
+    const auto indices = std::vector<std::uint32_t>{0, 1, 2, 3, 3, 2, 4};
+    arrays.face_offsets = offsets.data();
+    arrays.position_indices = indices.data();
+    arrays.face_count = offsets.size() - 1;
+
+    auto expected = std::string{};
+    auto face_index = std::size_t{0};
+    thinks::WriteObj(&expected, pos_mapper(), [&]() {
+      if (face_index == offsets.size() - 1) {
+        return thinks::ObjEnd<FaceType>();
+      }
+      auto face = FaceType{};
+      for (auto i = offsets[face_index]; i < offsets[face_index + 1]; ++i) {
+        face.values.push_back(IndexType{indices[i]});
+      }
+      ++face_index;
+      return thinks::ObjMap(face);
+    });
+
+    auto str = std::string{};
+    const auto result = thinks::WriteObjArrays(&str, arrays);
+
+    REQUIRE(result.face_count == 2);
+    REQUIRE(str == expected);
+  }
+
+  SECTION("index groups") {
+    using FaceType = thinks::ObjTriangleFace<IndexGroupType>;
+    const auto pos_indices = std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3};
+    const auto tex_indices = std::vector<std::uint32_t>{0, 1, 2, 0, 2, 1};
+    const auto nml_indices = std::vector<std::uint32_t>{0, 0, 0, 0, 0, 0};
+    arrays.tex_coords = tex_coords.data();
+    arrays.tex_coord_count = tex_coords.size() / 2;
+    arrays.normals = normals.data();
+    arrays.normal_count = normals.size() / 3;
+    arrays.position_indices = pos_indices.data();
+    arrays.face_count = pos_indices.size() / 3;
+
+    const auto face_mapper = [&](const bool tex, const bool nml) {
+      auto face_index = std::size_t{0};
+      return [&, tex, nml, face_index]() mutable {
+        if (3 * face_index == pos_indices.size()) {
+          return thinks::ObjEnd<FaceType>();
+        }
+        auto face = FaceType{};
+        for (auto i = std::size_t{0}; i < 3; ++i) {
+          const auto j = 3 * face_index + i;
+          face.values[i] = IndexGroupType(
+              pos_indices[j], std::make_pair(tex_indices[j], tex),
+              std::make_pair(nml_indices[j], nml));
+        }
+        ++face_index;
+        return thinks::ObjMap(face);
+      };
+    };
+
+    SECTION("position/tex/normal") {
+      arrays.tex_coord_indices = tex_indices.data();
+      arrays.normal_indices = nml_indices.data();
+
+      auto expected = std::string{};
+      thinks::WriteObj(&expected, pos_mapper(), face_mapper(true, true),
+                       tex_mapper(), nml_mapper());
+      auto str = std::string{};
+      const auto result = thinks::WriteObjArrays(&str, arrays);
+
+      REQUIRE(result.tex_coord_count == 3);
+      REQUIRE(result.normal_count == 1);
+      REQUIRE(str == expected);
+    }
+
+    SECTION("position/tex") {
+      arrays.tex_coord_indices = tex_indices.data();
+
+      auto expected = std::string{};
+      thinks::WriteObj(&expected, pos_mapper(), face_mapper(true, false),
+                       tex_mapper(), nml_mapper());
+      auto str = std::string{};
+      thinks::WriteObjArrays(&str, arrays);
+
+      REQUIRE(str == expected);
+    }
+
+    SECTION("position//normal") {
+      arrays.normal_indices = nml_indices.data();
+
+      auto expected = std::string{};
+      thinks::WriteObj(&expected, pos_mapper(), face_mapper(false, true),
+                       tex_mapper(), nml_mapper());
+      auto str = std::string{};
+      thinks::WriteObjArrays(&str, arrays);
+
+      REQUIRE(str == expected);
+    }
+  }
+
+  SECTION("face index count") {
+    const auto offsets = std::vector<std::uint32_t>{0, 3, 5};
+    const auto indices = std::vector<std::uint32_t>{0, 1, 2, 3, 4};
+    arrays.face_offsets = offsets.data();
+    arrays.position_indices = indices.data();
+    arrays.face_count = offsets.size() - 1;
+
+    auto str = std::string{};
+    REQUIRE_THROWS_MATCHES(
+        thinks::WriteObjArrays(&str, arrays), std::runtime_error,
+        ExceptionContentMatcher{
+            "faces must have at least 3 indices (found 2)"});
+  }
+
+  SECTION("face offsets") {
+    const auto offsets = std::vector<std::uint32_t>{0, 3, 1};
+    const auto indices = std::vector<std::uint32_t>{0, 1, 2};
+    arrays.face_offsets = offsets.data();
+    arrays.position_indices = indices.data();
+    arrays.face_count = offsets.size() - 1;
+
+    auto str = std::string{};
+    REQUIRE_THROWS_MATCHES(
+        thinks::WriteObjArrays(&str, arrays), std::runtime_error,
+        ExceptionContentMatcher{
+            "face offsets must be non-decreasing (found 1 after 3)"});
+  }
+
+  SECTION("texture coordinate range") {
+    const auto invalid_tex_coords = std::vector<float>{0.f, 1.5f};
+    arrays.tex_coords = invalid_tex_coords.data();
+    arrays.tex_coord_count = 1;
+
+    auto str = std::string{};
+    REQUIRE_THROWS_MATCHES(
+        thinks::WriteObjArrays(&str, arrays), std::runtime_error,
+        ExceptionContentMatcher{
+            "texture coordinate values must be in range [0, 1] (found 1.5)"});
+  }
+}
+
+TEST_CASE("WRITE - float precision") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using NormalType = thinks::ObjNormal<double>;
+  using FaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+
+  const auto face_mapper = []() { return thinks::ObjEnd<FaceType>(); };
+
+  SECTION("shortest") {
+    const auto positions = std::vector<PositionType>{
+        PositionType{0.1f, 1.2345678f, 16777216.f},
+        PositionType{-0.f, 1e-7f, 3.4028235e38f}};
+    auto pos_iter = positions.begin();
+    auto pos_mapper = [&pos_iter, &positions]() {
+      return pos_iter == positions.end() ? thinks::ObjEnd<PositionType>()
+                                         : thinks::ObjMap(*pos_iter++);
+    };
+
+    auto oss = std::ostringstream{};
+    oss << std::setprecision(2);  // Ignored.
+    thinks::WriteObj(oss, pos_mapper, face_mapper);
+
+    REQUIRE(oss.str() ==
+            "# Written by https://github.com/thinks/obj-io\n"
+            "v 0.1 1.2345678 16777216\n"
+            "v -0 1e-07 3.4028235e+38\n");
+  }
+
+  SECTION("notation") {
+    // Fixed or scientific notation, whichever is shorter (fixed if equal),
+    // as by std::to_chars. Same output for all language standards.
+    const auto positions = std::vector<PositionType>{
+        PositionType{1e6f, 1e5f, 1234567.f},
+        PositionType{1e-4f, 1e-3f, 123.25f},
+        PositionType{4324619776.f, -2.5e-10f, 1e-45f}};
+    const auto normals =
+        std::vector<NormalType>{NormalType{1e22, 0.3, 5e-324},
+                                NormalType{123456789012345680.0, -100.0,
+                                           1.7976931348623157e308}};
+    auto pos_iter = positions.begin();
+    auto pos_mapper = [&pos_iter, &positions]() {
+      return pos_iter == positions.end() ? thinks::ObjEnd<PositionType>()
+                                         : thinks::ObjMap(*pos_iter++);
+    };
+    auto nml_iter = normals.begin();
+    auto nml_mapper = [&nml_iter, &normals]() {
+      return nml_iter == normals.end() ? thinks::ObjEnd<NormalType>()
+                                       : thinks::ObjMap(*nml_iter++);
+    };
+
+    auto str = std::string{};
+    thinks::WriteObj(&str, pos_mapper, face_mapper, nullptr, nml_mapper);
+
+    REQUIRE(str ==
+            "# Written by https://github.com/thinks/obj-io\n"
+            "v 1e+06 1e+05 1234567\n"
+            "v 1e-04 0.001 123.25\n"
+            "v 4324619776 -2.5e-10 1e-45\n"
+            "vn 1e+22 0.3 5e-324\n"
+            "vn 123456789012345680 -100 1.7976931348623157e+308\n");
+  }
+
+  SECTION("round trip") {
+    auto rng = std::mt19937{1234};
+    auto mantissa_dist = std::uniform_real_distribution<double>{-1.0, 1.0};
+    auto exponent_dist = std::uniform_int_distribution<int>{-60, 60};
+    const auto random_value = [&]() {
+      return std::ldexp(mantissa_dist(rng), exponent_dist(rng));
+    };
+
+    auto positions = std::vector<PositionType>{};
+    auto normals = std::vector<NormalType>{};
+    for (auto i = 0; i < 1000; ++i) {
+      positions.push_back(PositionType{static_cast<float>(random_value()),
+                                       static_cast<float>(random_value()),
+                                       static_cast<float>(random_value())});
+      normals.push_back(
+          NormalType{random_value(), random_value(), random_value()});
+    }
+    auto pos_iter = positions.begin();
+    auto pos_mapper = [&pos_iter, &positions]() {
+      return pos_iter == positions.end() ? thinks::ObjEnd<PositionType>()
+                                         : thinks::ObjMap(*pos_iter++);
+    };
+    auto nml_iter = normals.begin();
+    auto nml_mapper = [&nml_iter, &normals]() {
+      return nml_iter == normals.end() ? thinks::ObjEnd<NormalType>()
+                                       : thinks::ObjMap(*nml_iter++);
+    };
+
+    auto oss = std::ostringstream{};
+    thinks::WriteObj(oss, pos_mapper, face_mapper, nullptr, nml_mapper);
+    const auto str = oss.str();
+
+    auto read_positions = std::vector<PositionType>{};
+    auto read_normals = std::vector<NormalType>{};
+    thinks::ReadObj(
+        str.data(), str.size(),
+        thinks::MakeObjAddFunc<PositionType>(
+            [&read_positions](const auto& p) { read_positions.push_back(p); }),
+        thinks::MakeObjAddFunc<FaceType>([](const auto&) {}), nullptr,
+        thinks::MakeObjAddFunc<NormalType>(
+            [&read_normals](const auto& n) { read_normals.push_back(n); }));
+
+    REQUIRE(read_positions.size() == positions.size());
+    REQUIRE(read_normals.size() == normals.size());
+    for (auto i = std::size_t{0}; i < positions.size(); ++i) {
+      REQUIRE(read_positions[i].values == positions[i].values);
+      REQUIRE(read_normals[i].values == normals[i].values);
+    }
+  }
+}
+
+TEST_CASE("WRITE - integer values") {
+  using FaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint16_t>>;
+
+  const auto write_positions = [](const auto& positions) {
+    using PositionType =
+        typename std::decay<decltype(positions)>::type::value_type;
+    auto str = std::string{};
+    auto pos_iter = positions.begin();
+    thinks::WriteObj(
+        &str,
+        [&pos_iter, &positions]() {
+          return pos_iter == positions.end() ? thinks::ObjEnd<PositionType>()
+                                             : thinks::ObjMap(*pos_iter++);
+        },
+        []() { return thinks::ObjEnd<FaceType>(); });
+    return str.substr(str.find('\n') + 1);  // Skip header.
+  };
+
+  SECTION("signed") {
+    using IntType = std::int64_t;
+    using PositionType = thinks::ObjPosition<IntType, 3>;
+    const auto positions = std::vector<PositionType>{
+        PositionType{0, -1, 9},
+        PositionType{10, -99, 100},
+        PositionType{std::numeric_limits<IntType>::max(),
+                     std::numeric_limits<IntType>::min(), -1234567}};
+
+    REQUIRE(write_positions(positions) ==
+            "v 0 -1 9\n"
+            "v 10 -99 100\n"
+            "v 9223372036854775807 -9223372036854775808 -1234567\n");
+  }
+
+  SECTION("unsigned") {
+    using IntType = std::uint16_t;
+    using PositionType = thinks::ObjPosition<IntType, 3>;
+    const auto positions =
+        std::vector<PositionType>{PositionType{0, 7, 65535}};
+
+    REQUIRE(write_positions(positions) == "v 0 7 65535\n");
+  }
+
+  SECTION("same as stream") {
+    using IntType = std::int32_t;
+    using PositionType = thinks::ObjPosition<IntType, 3>;
+    auto rng = std::mt19937{42};
+    auto dist = std::uniform_int_distribution<IntType>{
+        std::numeric_limits<IntType>::min(),
+        std::numeric_limits<IntType>::max()};
+    auto positions = std::vector<PositionType>{};
+    auto expected = std::ostringstream{};
+    for (auto i = 0; i < 1000; ++i) {
+      const auto p = PositionType{dist(rng), dist(rng), dist(rng) % 1000};
+      positions.push_back(p);
+      expected << "v " << p.values[0] << " " << p.values[1] << " "
+               << p.values[2] << "\n";
+    }
+
+    REQUIRE(write_positions(positions) == expected.str());
+  }
+}
+
+TEST_CASE("WRITE - index formatting") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+
+  const auto pos_mapper = []() { return thinks::ObjEnd<PositionType>(); };
+
+  SECTION("indices") {
+    using IndexType = thinks::ObjIndex<std::uint64_t>;
+    using FaceType = thinks::ObjQuadFace<IndexType>;
+
+    auto done = false;
+    auto face_mapper = [&done]() {
+      if (done) {
+        return thinks::ObjEnd<FaceType>();
+      }
+      done = true;
+      return thinks::ObjMap(FaceType{IndexType{0}, IndexType{9},
+                                     IndexType{99},
+                                     IndexType{12345678900}});
+    };
+
+    auto oss = std::ostringstream{};
+    thinks::WriteObj(oss, pos_mapper, face_mapper);
+
+    REQUIRE(oss.str() ==
+            "# Written by https://github.com/thinks/obj-io\n"
+            "f 1 10 100 12345678901\n");
+  }
+
+  SECTION("index group layouts") {
+    using IndexType = thinks::ObjIndexGroup<std::uint32_t>;
+    using FaceType = thinks::ObjSmallPolygonFace<IndexType>;
+
+    const auto none = std::make_pair(std::uint32_t{0}, false);
+    const auto some = [](const std::uint32_t i) {
+      return std::make_pair(i, true);
+    };
+    const auto faces = std::vector<FaceType>{
+        FaceType{IndexType{0}, IndexType{1}, IndexType{2}},
+        FaceType{IndexType{0, some(3), none}, IndexType{1, some(4), none},
+                 IndexType{2, some(5), none}},
+        FaceType{IndexType{0, none, some(6)}, IndexType{1, none, some(7)},
+                 IndexType{2, none, some(8)}},
+        FaceType{IndexType{0, 3, 6}, IndexType{1, 4, 7}, IndexType{2, 5, 8}},
+        // Mixed layouts.
+        FaceType{IndexType{0}, IndexType{1, some(4), none},
+                 IndexType{2, 5, 8}}};
+    auto face_iter = faces.begin();
+    auto face_mapper = [&face_iter, &faces]() {
+      return face_iter == faces.end() ? thinks::ObjEnd<FaceType>()
+                                      : thinks::ObjMap(*face_iter++);
+    };
+
+    auto oss = std::ostringstream{};
+    thinks::WriteObj(oss, pos_mapper, face_mapper);
+
+    REQUIRE(oss.str() ==
+            "# Written by https://github.com/thinks/obj-io\n"
+            "f 1 2 3\n"
+            "f 1/4 2/5 3/6\n"
+            "f 1//7 2//8 3//9\n"
+            "f 1/4/7 2/5/8 3/6/9\n"
+            "f 1 2/5 3/6/9\n");
+  }
+}
+
+TEST_CASE("WRITE - small polygons") {
+  using PositionType = thinks::ObjPosition<float, 3>;
+  using IndexType = thinks::ObjIndex<std::uint16_t>;
+  using FaceType = thinks::ObjSmallPolygonFace<IndexType, 4>;
+
+  const auto positions = std::vector<PositionType>{
+      PositionType{1.f, 2.f, 3.f}, PositionType{4.f, 5.f, 6.f},
+      PositionType{7.f, 8.f, 9.f}};
+
+  // Second face does not fit in inline storage.
+  const auto i0 = IndexType{0};
+  const auto i1 = IndexType{1};
+  const auto i2 = IndexType{2};
+  const auto faces = std::vector<FaceType>{
+      FaceType{i0, i1, i2}, FaceType{i2, i1, i0, i2, i1, i0}};
+
+  auto pos_iter = positions.begin();
+  auto pos_mapper = [&pos_iter, &positions]() {
+    return pos_iter == positions.end() ? thinks::ObjEnd<PositionType>()
+                                       : thinks::ObjMap(*pos_iter++);
+  };
+  auto face_iter = faces.begin();
+  auto face_mapper = [&face_iter, &faces]() {
+    return face_iter == faces.end() ? thinks::ObjEnd<FaceType>()
+                                    : thinks::ObjMap(*face_iter++);
+  };
+
+  auto oss = std::ostringstream{};
+  const auto result = thinks::WriteObj(oss, pos_mapper, face_mapper);
+
+  REQUIRE(result.face_count == 2);
+  REQUIRE(oss.str() ==
+          "# Written by https://github.com/thinks/obj-io\n"
+          "v 1 2 3\n"
+          "v 4 5 6\n"
+          "v 7 8 9\n"
+          "f 1 2 3\n"
+          "f 3 2 1 3 2 1\n");
+}
+
 TEST_CASE("WRITE - texture coordinate range", "[container]") {
   using MeshType = Mesh<>;
   using VertexType = MeshType::VertexType;